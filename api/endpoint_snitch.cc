@@ -22,6 +22,7 @@
 #include "locator/snitch_base.hh"
 #include "endpoint_snitch.hh"
 #include "api/api-doc/endpoint_snitch_info.json.hh"
+#include "service/storage_proxy.hh"
 #include "utils/fb_utilities.hh"
 
 namespace api {
@@ -43,6 +44,32 @@ void set_endpoint_snitch(http_context& ctx, routes& r) {
     httpd::endpoint_snitch_info_json::get_snitch_name.set(r, [] (const_req req) {
         return locator::i_endpoint_snitch::get_local_snitch_ptr()->get_name();
     });
+
+    httpd::endpoint_snitch_info_json::get_dynamic_scores.set(r, [&ctx] (std::unique_ptr<request> req) {
+        // Sum of the scores and the number of shards which have one.
+        using scores = std::map<gms::inet_address, std::pair<double, unsigned>>;
+        return ctx.sp.map_reduce0([] (const service::storage_proxy& sp) {
+            scores res;
+            for (auto&& e : sp.get_dynamic_snitch().scores()) {
+                res.emplace(e.first, std::make_pair(e.second, 1u));
+            }
+            return res;
+        }, scores(), [] (scores res, const scores& shard) {
+            for (auto&& e : shard) {
+                auto& s = res[e.first];
+                s.first += e.second.first;
+                s.second += e.second.second;
+            }
+            return res;
+        }).then([] (scores s) {
+            std::map<gms::inet_address, double> avg;
+            for (auto&& e : s) {
+                avg.emplace(e.first, e.second.first / e.second.second);
+            }
+            std::vector<httpd::endpoint_snitch_info_json::mapper> res;
+            return make_ready_future<json::json_return_type>(map_to_key_value(avg, res));
+        });
+    });
 }
 
 }
@@ -289,18 +289,23 @@ scylla_tests = [
     'tests/sstable_resharding_test',
     'tests/memtable_test',
     'tests/commitlog_test',
+    'tests/commitlog_replayer_test',
     'tests/cartesian_product_test',
     'tests/hash_test',
     'tests/map_difference_test',
     'tests/message',
     'tests/gossip',
     'tests/gossip_test',
+    'tests/messaging_service_test',
+    'tests/hints_test',
+    'tests/cache_warmer_test',
     'tests/compound_test',
     'tests/config_test',
     'tests/gossiping_property_file_snitch_test',
     'tests/ec2_snitch_test',
     'tests/gce_snitch_test',
     'tests/snitch_reset_test',
+    'tests/dynamic_snitch_test',
     'tests/network_topology_strategy_test',
     'tests/query_processor_test',
     'tests/batchlog_manager_test',
@@ -326,6 +331,7 @@ scylla_tests = [
     'tests/view_schema_test',
     'tests/view_build_test',
     'tests/view_complex_test',
+    'tests/view_update_test',
     'tests/counter_test',
     'tests/cell_locker_test',
     'tests/row_locker_test',
@@ -582,10 +588,12 @@ scylla_core = (['database.cc',
                 'db/commitlog/commitlog_entry.cc',
                 'db/hints/manager.cc',
                 'db/hints/resource_manager.cc',
+                'db/hints/hints_batch.cc',
                 'db/config.cc',
                 'db/extensions.cc',
                 'db/heat_load_balance.cc',
                 'db/large_partition_handler.cc',
+                'db/cache_warmer.cc',
                 'db/marshal/type_parser.cc',
                 'db/batchlog_manager.cc',
                 'db/view/view.cc',
@@ -637,7 +645,9 @@ scylla_core = (['database.cc',
                 'locator/ec2_snitch.cc',
                 'locator/ec2_multi_region_snitch.cc',
                 'locator/gce_snitch.cc',
+                'locator/dynamic_snitch.cc',
                 'message/messaging_service.cc',
+                'message/mutation_batch.cc',
                 'service/client_state.cc',
                 'service/migration_task.cc',
                 'service/storage_service.cc',
@@ -758,6 +768,8 @@ idls = ['idl/gossip_digest.idl.hh',
         'idl/tracing.idl.hh',
         'idl/consistency_level.idl.hh',
         'idl/cache_temperature.idl.hh',
+        'idl/view.idl.hh',
+        'idl/mutation_batch.idl.hh',
         ]
 
 scylla_tests_dependencies = scylla_core + idls + [
@@ -337,16 +337,28 @@ const std::vector<::shared_ptr<restrictions>>& statement_restrictions::index_res
 }
 
 std::optional<secondary_index::index> statement_restrictions::find_idx(secondary_index::secondary_index_manager& sim) const {
+    // A local index only has to be read in the restricted partitions, so it
+    // is preferred when the whole partition key is restricted by EQ. Otherwise
+    // a global index avoids reading the local index in every partition.
+    bool prefer_local = !_partition_key_restrictions->is_on_token()
+            && !_partition_key_restrictions->has_unrestricted_components(*_schema)
+            && _partition_key_restrictions->is_all_eq();
+    std::optional<secondary_index::index> fallback;
     for (::shared_ptr<cql3::restrictions::restrictions> restriction : index_restrictions()) {
         for (const auto& cdef : restriction->get_column_defs()) {
             for (auto index : sim.list_indexes()) {
                 if (index.depends_on(*cdef)) {
-                    return std::make_optional<secondary_index::index>(std::move(index));
+                    if (index.is_local() == prefer_local) {
+                        return std::make_optional<secondary_index::index>(std::move(index));
+                    }
+                    if (!fallback) {
+                        fallback = std::move(index);
+                    }
                 }
             }
         }
     }
-    return std::nullopt;
+    return fallback;
 }
 
 std::vector<const column_definition*> statement_restrictions::get_column_defs_for_filtering(database& db) const {
@@ -59,11 +59,13 @@ namespace statements {
 create_index_statement::create_index_statement(::shared_ptr<cf_name> name,
                                                ::shared_ptr<index_name> index_name,
                                                std::vector<::shared_ptr<index_target::raw>> raw_targets,
+                                               std::vector<::shared_ptr<column_identifier::raw>> local_partition_key,
                                                ::shared_ptr<index_prop_defs> properties,
                                                bool if_not_exists)
     : schema_altering_statement(name)
     , _index_name(index_name->get_idx())
     , _raw_targets(raw_targets)
+    , _local_partition_key(std::move(local_partition_key))
     , _properties(properties)
     , _if_not_exists(if_not_exists)
 {
@@ -101,6 +103,10 @@ create_index_statement::validate(service::storage_proxy& proxy, const service::c
         validate_targets_for_multi_column_index(targets);
     }
 
+    if (!_local_partition_key.empty()) {
+        validate_local_index(schema, targets);
+    }
+
     for (auto& target : targets) {
         auto cd = schema->get_column_definition(target->column->name());
 
@@ -219,11 +225,39 @@ void create_index_statement::validate_targets_for_multi_column_index(std::vector
     }
 }
 
+void create_index_statement::validate_local_index(schema_ptr schema, const std::vector<::shared_ptr<index_target>>& targets) const
+{
+    if (_properties->is_custom) {
+        throw exceptions::invalid_request_exception("CUSTOM indexes cannot be local");
+    }
+    if (targets.size() != 1) {
+        throw exceptions::invalid_request_exception("Local indexes must have exactly one target column");
+    }
+    auto cd = schema->get_column_definition(targets[0]->column->name());
+    if (cd && cd->is_partition_key()) {
+        throw exceptions::invalid_request_exception(
+                format("Cannot create local index on partition key column {}", *targets[0]->column));
+    }
+    auto pk = schema->partition_key_columns();
+    auto matches = _local_partition_key.size() == schema->partition_key_size()
+            && std::equal(_local_partition_key.begin(), _local_partition_key.end(), pk.begin(),
+                    [&schema] (const ::shared_ptr<column_identifier::raw>& raw, const column_definition& def) {
+                        return raw->prepare_column_identifier(schema)->name() == def.name();
+                    });
+    if (!matches) {
+        throw exceptions::invalid_request_exception(
+                "Local index definition must list the full partition key of the base table, in order");
+    }
+}
+
 future<::shared_ptr<cql_transport::event::schema_change>>
 create_index_statement::announce_migration(service::storage_proxy& proxy, bool is_local_only) {
     if (!service::get_local_storage_service().cluster_supports_indexes()) {
         throw exceptions::invalid_request_exception("Index support is not enabled");
     }
+    if (!_local_partition_key.empty() && !service::get_local_storage_service().cluster_supports_local_indexes()) {
+        throw exceptions::invalid_request_exception("Local index support is not enabled");
+    }
     auto& db = proxy.get_db().local();
     auto schema = db.find_schema(keyspace(), column_family());
     std::vector<::shared_ptr<index_target>> targets;
@@ -245,6 +279,9 @@ create_index_statement::announce_migration(service::storage_proxy& proxy, bool i
         index_options = _properties->get_options();
     } else {
         kind = schema->is_compound() ? index_metadata_kind::composites : index_metadata_kind::keys;
+        if (!_local_partition_key.empty()) {
+            index_options.emplace(index_target::local_option_name, "true");
+        }
     }
     auto index = make_index_metadata(schema, targets, accepted_name, kind, index_options);
     auto existing_index = schema->find_index_noname(index);
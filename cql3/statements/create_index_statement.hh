@@ -68,6 +68,9 @@ namespace statements {
 class create_index_statement : public schema_altering_statement {
     const sstring _index_name;
     const std::vector<::shared_ptr<index_target::raw>> _raw_targets;
+    // Non-empty for a local index, which is co-located with the base
+    // partition: lists the base partition key columns, in order.
+    const std::vector<::shared_ptr<column_identifier::raw>> _local_partition_key;
     const ::shared_ptr<index_prop_defs> _properties;
     const bool _if_not_exists;
     cql_stats* _cql_stats = nullptr;
@@ -75,6 +78,7 @@ class create_index_statement : public schema_altering_statement {
 public:
     create_index_statement(::shared_ptr<cf_name> name, ::shared_ptr<index_name> index_name,
             std::vector<::shared_ptr<index_target::raw>> raw_targets,
+            std::vector<::shared_ptr<column_identifier::raw>> local_partition_key,
             ::shared_ptr<index_prop_defs> properties, bool if_not_exists);
 
     future<> check_access(const service::client_state& state) override;
@@ -89,6 +93,7 @@ class create_index_statement : public schema_altering_statement {
                                                                   ::shared_ptr<index_target> target) const;
     void validate_target_column_is_map_if_index_involves_keys(bool is_map, ::shared_ptr<index_target> target) const;
     void validate_targets_for_multi_column_index(std::vector<::shared_ptr<index_target>> targets) const;
+    void validate_local_index(schema_ptr schema, const std::vector<::shared_ptr<index_target>>& targets) const;
     static index_metadata make_index_metadata(schema_ptr schema,
                                               const std::vector<::shared_ptr<index_target>>& targets,
                                               const sstring& name,
@@ -51,6 +51,7 @@ using db::index::secondary_index;
 
 const sstring index_target::target_option_name = "target";
 const sstring index_target::custom_index_option_name = "class_name";
+const sstring index_target::local_option_name = "local";
 
 sstring index_target::as_cql_string(schema_ptr schema) const {
     if (!schema->get_column_definition(column->name())->type->is_collection()) {
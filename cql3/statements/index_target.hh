@@ -51,6 +51,7 @@ namespace statements {
 struct index_target {
     static const sstring target_option_name;
     static const sstring custom_index_option_name;
+    static const sstring local_option_name;
 
     enum class target_type {
         values, keys, keys_and_values, full
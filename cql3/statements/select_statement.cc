@@ -58,6 +58,7 @@
 #include "db/timeout_clock.hh"
 #include "db/consistency_level_validations.hh"
 #include <boost/algorithm/cxx11/any_of.hpp>
+#include <deque>
 
 namespace cql3 {
 
@@ -500,11 +501,11 @@ indexed_table_select_statement::execute_base_query(
 // Function for fetching the selected columns from a list of clustering rows.
 // It is currently used only in our Secondary Index implementation - ordinary
 // CQL SELECT statements do not have the syntax to request a list of rows.
-// FIXME: The current implementation is very inefficient - it requests each
-// row separately (and, incrementally, in parallel). Even multiple rows from a single
-// partition are requested separately. This last case can be easily improved,
-// but to implement the general case (multiple rows from multiple partitions)
-// efficiently, we will need more support from other layers.
+// Rows of the same partition are adjacent in the list, and are requested
+// together, in a single query with one clustering range per row. Up to
+// max_concurrent_base_lookups such queries are kept in flight, and their
+// results are merged in key order as they arrive, so the latency of a page
+// does not grow linearly with the number of partitions in it.
 // Keys are ordered in token order (see #3423)
 future<shared_ptr<cql_transport::messages::result_message>>
 indexed_table_select_statement::execute_base_query(
@@ -517,10 +518,13 @@ indexed_table_select_statement::execute_base_query(
     auto cmd = prepare_command_for_base_query(options, state, now, bool(paging_state));
     auto timeout = db::timeout_clock::now() + options.get_timeout_config().*get_timeout_config_selector();
 
+    using result_ptr = foreign_ptr<lw_shared_ptr<query::result>>;
     struct base_query_state {
         query::result_merger merger;
         std::vector<primary_key> primary_keys;
         std::vector<primary_key>::iterator current_primary_key;
+        // Lookups in flight, in key order.
+        std::deque<future<result_ptr>> in_flight;
         base_query_state(uint32_t row_limit, std::vector<primary_key>&& keys)
                 : merger(row_limit, query::max_partitions)
                 , primary_keys(std::move(keys))
@@ -535,30 +539,45 @@ indexed_table_select_statement::execute_base_query(
         auto &merger = query_state.merger;
         auto &keys = query_state.primary_keys;
         auto &key_it = query_state.current_primary_key;
-        return repeat([this, &keys, &key_it, &merger, &proxy, &state, &options, cmd, timeout]() {
-            // Starting with 1 key, we check if the result was a short read, and if not,
-            // we continue exponentially, asking for 2x more key than before
-            auto key_it_end = std::min(key_it + std::distance(keys.begin(), key_it) + 1, keys.end());
+        auto &in_flight = query_state.in_flight;
+        auto query_partition = [this, &proxy, &state, &options, cmd, timeout] (std::vector<primary_key>::iterator begin, std::vector<primary_key>::iterator end) {
             auto command = ::make_lw_shared<query::read_command>(*cmd);
-
-            query::result_merger oneshot_merger(cmd->row_limit, query::max_partitions);
-            return map_reduce(key_it, key_it_end, [this, &proxy, &state, &options, cmd, timeout] (auto& key) {
-                auto command = ::make_lw_shared<query::read_command>(*cmd);
-                // for each partition, read just one clustering row (TODO: can
-                // get all needed rows of one partition at once.)
-                command->slice._row_ranges.clear();
-                if (key.clustering) {
-                    command->slice._row_ranges.push_back(query::clustering_range::make_singular(key.clustering));
+            command->slice._row_ranges.clear();
+            for (auto it = begin; it != end; ++it) {
+                if (it->clustering) {
+                    command->slice._row_ranges.push_back(query::clustering_range::make_singular(it->clustering));
                 }
-                return proxy.query(_schema, command, {dht::partition_range::make_singular(key.partition)}, options.get_consistency(), {timeout, state.get_trace_state()})
-                .then([] (service::storage_proxy::coordinator_query_result qr) {
-                    return std::move(qr.query_result);
+            }
+            return proxy.query(_schema, command, {dht::partition_range::make_singular(begin->partition)}, options.get_consistency(), {timeout, state.get_trace_state()})
+            .then([] (service::storage_proxy::coordinator_query_result qr) {
+                return std::move(qr.query_result);
+            });
+        };
+        return repeat([this, &keys, &key_it, &in_flight, &merger, query_partition = std::move(query_partition)] () mutable {
+            while (in_flight.size() < max_concurrent_base_lookups && key_it != keys.end()) {
+                auto partition_end = std::find_if(std::next(key_it), keys.end(), [this, &key_it] (const primary_key& key) {
+                    return !key.partition.equal(*_schema, key_it->partition);
                 });
-            }, std::move(oneshot_merger)).then([&key_it, key_it_end = std::move(key_it_end), &keys, &merger] (foreign_ptr<lw_shared_ptr<query::result>> result) {
+                in_flight.push_back(query_partition(key_it, partition_end));
+                key_it = partition_end;
+            }
+            if (in_flight.empty()) {
+                return make_ready_future<stop_iteration>(stop_iteration::yes);
+            }
+            auto f = std::move(in_flight.front());
+            in_flight.pop_front();
+            return f.then([&merger] (result_ptr result) {
                 bool is_short_read = result->is_short_read();
                 merger(std::move(result));
-                key_it = key_it_end;
-                return stop_iteration(is_short_read || key_it == keys.end());
+                return stop_iteration(is_short_read);
+            });
+        }).finally([&in_flight] {
+            // After a short read or a failure, wait for the lookups still in
+            // flight, which refer to our state, and drop their results.
+            return when_all(std::make_move_iterator(in_flight.begin()), std::make_move_iterator(in_flight.end())).then([] (std::vector<future<result_ptr>> results) {
+                for (auto& f : results) {
+                    f.ignore_ready_future();
+                }
             });
         }).then([&merger] () {
             return merger.get();
@@ -748,6 +767,19 @@ static void append_base_key_to_index_ck(std::vector<bytes_view>& exploded_index_
     std::move(begin, key_view.end(), std::back_inserter(exploded_index_ck));
 }
 
+// Returns the value the query looks up in the index on the given column.
+// Executing the indexed_table branch implies there is at least one index
+// restriction on it.
+static bytes_opt find_index_value(const ::shared_ptr<restrictions::statement_restrictions>& restrictions,
+        const column_definition& cdef, const query_options& options) {
+    for (const auto& r : restrictions->index_restrictions()) {
+        if (auto value = r->value_for(cdef, options)) {
+            return value;
+        }
+    }
+    throw exceptions::invalid_request_exception(format("No value given for indexed column {}", cdef.name_as_text()));
+}
+
 ::shared_ptr<const service::pager::paging_state> indexed_table_select_statement::generate_view_paging_state_from_base_query_results(::shared_ptr<const service::pager::paging_state> paging_state,
         const foreign_ptr<lw_shared_ptr<query::result>>& results, service::storage_proxy& proxy, service::query_state& state, const query_options& options) const {
     const column_definition* cdef = _schema->get_column_definition(to_bytes(_index.target_column()));
@@ -755,9 +787,6 @@ ::shared_ptr<const service::pager::paging_state> indexed_table_select_statement:
         throw exceptions::invalid_request_exception("Indexed column not found in schema");
     }
 
-    //NOTICE(sarna): Executing indexed_table branch implies there was at least 1 index restriction present
-    bytes_opt index_pk_value = _restrictions->index_restrictions().front()->value_for(*cdef, options);
-    auto index_pk = partition_key::from_single_value(*_view_schema, *index_pk_value);
     auto result_view = query::result_view(*results);
     if (!results->row_count() || *results->row_count() == 0) {
         return std::move(paging_state);
@@ -767,10 +796,20 @@ ::shared_ptr<const service::pager::paging_state> indexed_table_select_statement:
     std::vector<bytes_view> exploded_index_ck;
     exploded_index_ck.reserve(_view_schema->clustering_key_size());
 
-    dht::i_partitioner& partitioner = dht::global_partitioner();
-    bytes token_bytes = partitioner.token_to_bytes(partitioner.get_token(*_schema, last_base_pk));
-    exploded_index_ck.push_back(bytes_view(token_bytes));
-    append_base_key_to_index_ck<partition_key>(exploded_index_ck, last_base_pk, *cdef);
+    partition_key index_pk = last_base_pk;
+    bytes_opt index_value = find_index_value(_restrictions, *cdef, options);
+    bytes token_bytes;
+    if (_index.is_local()) {
+        // A local index view is keyed by the base partition key and
+        // clustered by the indexed value, then the base clustering key.
+        exploded_index_ck.push_back(bytes_view(*index_value));
+    } else {
+        index_pk = partition_key::from_single_value(*_view_schema, *index_value);
+        dht::i_partitioner& partitioner = dht::global_partitioner();
+        token_bytes = partitioner.token_to_bytes(partitioner.get_token(*_schema, last_base_pk));
+        exploded_index_ck.push_back(bytes_view(token_bytes));
+        append_base_key_to_index_ck<partition_key>(exploded_index_ck, last_base_pk, *cdef);
+    }
     if (last_base_ck) {
         append_base_key_to_index_ck<clustering_key>(exploded_index_ck, *last_base_ck, *cdef);
     }
@@ -878,50 +917,82 @@ read_posting_list(service::storage_proxy& proxy,
                   cql3::cql_stats& stats)
 {
     dht::partition_range_vector partition_ranges;
-    // FIXME: there should be only one index restriction for this index!
-    // Perhaps even one index restriction entirely (do we support
-    // intersection queries?).
-    for (const auto& restrictions : base_restrictions->index_restrictions()) {
+    partition_slice_builder partition_slice_builder{*view_schema};
+
+    if (index.is_local()) {
+        // A local index view shares the base partition key, so we read the
+        // same partitions the base query would, and within them only the
+        // rows clustered under the indexed value.
         const column_definition* cdef = base_schema->get_column_definition(to_bytes(index.target_column()));
         if (!cdef) {
             throw exceptions::invalid_request_exception("Indexed column not found in schema");
         }
-
-        bytes_opt value = restrictions->value_for(*cdef, options);
-        if (value) {
-            auto pk = partition_key::from_single_value(*view_schema, *value);
-            auto dk = dht::global_partitioner().decorate_key(*view_schema, pk);
-            auto range = dht::partition_range::make_singular(dk);
-            partition_ranges.emplace_back(range);
+        partition_ranges = base_restrictions->get_partition_key_ranges(options);
+
+        auto clustering_restrictions = ::make_shared<restrictions::single_column_primary_key_restrictions<clustering_key_prefix>>(view_schema, false);
+        const column_definition& value_cdef = *view_schema->clustering_key_columns().begin();
+        bytes_opt value = find_index_value(base_restrictions, *cdef, options);
+        auto value_restriction = ::make_shared<restrictions::single_column_restriction::EQ>(value_cdef, ::make_shared<cql3::constants::value>(cql3::raw_value::make_value(*value)));
+        clustering_restrictions->merge_with(value_restriction);
+
+        if (base_restrictions->get_clustering_columns_restrictions()->prefix_size() > 0) {
+            auto single_ck_restrictions = dynamic_pointer_cast<restrictions::single_column_primary_key_restrictions<clustering_key>>(base_restrictions->get_clustering_columns_restrictions());
+            if (single_ck_restrictions) {
+                auto prefix_restrictions = single_ck_restrictions->get_longest_prefix_restrictions();
+                auto clustering_restrictions_from_base = ::make_shared<restrictions::single_column_primary_key_restrictions<clustering_key_prefix>>(view_schema, *prefix_restrictions);
+                for (auto restriction_it : clustering_restrictions_from_base->restrictions()) {
+                    if (restriction_it.first->name() != cdef->name()) {
+                        clustering_restrictions->merge_with(restriction_it.second);
+                    }
+                }
+            }
         }
-    }
 
-    partition_slice_builder partition_slice_builder{*view_schema};
+        partition_slice_builder.with_ranges(clustering_restrictions->bounds_ranges(options));
+    } else {
+        // FIXME: there should be only one index restriction for this index!
+        // Perhaps even one index restriction entirely (do we support
+        // intersection queries?).
+        for (const auto& restrictions : base_restrictions->index_restrictions()) {
+            const column_definition* cdef = base_schema->get_column_definition(to_bytes(index.target_column()));
+            if (!cdef) {
+                throw exceptions::invalid_request_exception("Indexed column not found in schema");
+            }
 
-    if (!base_restrictions->has_partition_key_unrestricted_components()) {
-        auto single_pk_restrictions = dynamic_pointer_cast<restrictions::single_column_primary_key_restrictions<partition_key>>(base_restrictions->get_partition_key_restrictions());
-        // Only EQ restrictions on base partition key can be used in an index view query
-        if (single_pk_restrictions && single_pk_restrictions->is_all_eq()) {
-            auto clustering_restrictions = ::make_shared<restrictions::single_column_primary_key_restrictions<clustering_key_prefix>>(view_schema, *single_pk_restrictions);
-            // Computed token column needs to be added to index view restrictions
-            const column_definition& token_cdef = *view_schema->clustering_key_columns().begin();
-            auto base_pk = partition_key::from_optional_exploded(*base_schema, base_restrictions->get_partition_key_restrictions()->values(options));
-            bytes token_value = dht::global_partitioner().token_to_bytes(dht::global_partitioner().get_token(*base_schema, base_pk));
-            auto token_restriction = ::make_shared<restrictions::single_column_restriction::EQ>(token_cdef, ::make_shared<cql3::constants::value>(cql3::raw_value::make_value(token_value)));
-            clustering_restrictions->merge_with(token_restriction);
-
-            if (base_restrictions->get_clustering_columns_restrictions()->prefix_size() > 0) {
-                auto single_ck_restrictions = dynamic_pointer_cast<restrictions::single_column_primary_key_restrictions<clustering_key>>(base_restrictions->get_clustering_columns_restrictions());
-                if (single_ck_restrictions) {
-                    auto prefix_restrictions = single_ck_restrictions->get_longest_prefix_restrictions();
-                    auto clustering_restrictions_from_base = ::make_shared<restrictions::single_column_primary_key_restrictions<clustering_key_prefix>>(view_schema, *prefix_restrictions);
-                    for (auto restriction_it : clustering_restrictions_from_base->restrictions()) {
-                        clustering_restrictions->merge_with(restriction_it.second);
+            bytes_opt value = restrictions->value_for(*cdef, options);
+            if (value) {
+                auto pk = partition_key::from_single_value(*view_schema, *value);
+                auto dk = dht::global_partitioner().decorate_key(*view_schema, pk);
+                auto range = dht::partition_range::make_singular(dk);
+                partition_ranges.emplace_back(range);
+            }
+        }
+
+        if (!base_restrictions->has_partition_key_unrestricted_components()) {
+            auto single_pk_restrictions = dynamic_pointer_cast<restrictions::single_column_primary_key_restrictions<partition_key>>(base_restrictions->get_partition_key_restrictions());
+            // Only EQ restrictions on base partition key can be used in an index view query
+            if (single_pk_restrictions && single_pk_restrictions->is_all_eq()) {
+                auto clustering_restrictions = ::make_shared<restrictions::single_column_primary_key_restrictions<clustering_key_prefix>>(view_schema, *single_pk_restrictions);
+                // Computed token column needs to be added to index view restrictions
+                const column_definition& token_cdef = *view_schema->clustering_key_columns().begin();
+                auto base_pk = partition_key::from_optional_exploded(*base_schema, base_restrictions->get_partition_key_restrictions()->values(options));
+                bytes token_value = dht::global_partitioner().token_to_bytes(dht::global_partitioner().get_token(*base_schema, base_pk));
+                auto token_restriction = ::make_shared<restrictions::single_column_restriction::EQ>(token_cdef, ::make_shared<cql3::constants::value>(cql3::raw_value::make_value(token_value)));
+                clustering_restrictions->merge_with(token_restriction);
+
+                if (base_restrictions->get_clustering_columns_restrictions()->prefix_size() > 0) {
+                    auto single_ck_restrictions = dynamic_pointer_cast<restrictions::single_column_primary_key_restrictions<clustering_key>>(base_restrictions->get_clustering_columns_restrictions());
+                    if (single_ck_restrictions) {
+                        auto prefix_restrictions = single_ck_restrictions->get_longest_prefix_restrictions();
+                        auto clustering_restrictions_from_base = ::make_shared<restrictions::single_column_primary_key_restrictions<clustering_key_prefix>>(view_schema, *prefix_restrictions);
+                        for (auto restriction_it : clustering_restrictions_from_base->restrictions()) {
+                            clustering_restrictions->merge_with(restriction_it.second);
+                        }
                     }
                 }
-            }
 
-            partition_slice_builder.with_ranges(clustering_restrictions->bounds_ranges(options));
+                partition_slice_builder.with_ranges(clustering_restrictions->bounds_ranges(options));
+            }
         }
     }
 
@@ -161,6 +161,9 @@ class primary_key_select_statement : public select_statement {
 class indexed_table_select_statement : public select_statement {
     secondary_index::index _index;
     schema_ptr _view_schema;
+    // Bounds the number of base table partitions read concurrently when
+    // fetching the rows found in the index.
+    static constexpr size_t max_concurrent_base_lookups = 32;
 public:
     static ::shared_ptr<cql3::statements::select_statement> prepare(database& db,
                                                                     schema_ptr schema,
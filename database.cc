@@ -53,6 +53,7 @@
 #include <boost/range/algorithm/find.hpp>
 #include <boost/range/algorithm/find_if.hpp>
 #include <boost/range/algorithm/sort.hpp>
+#include <boost/range/numeric.hpp>
 #include <boost/range/adaptor/map.hpp>
 #include "frozen_mutation.hh"
 #include "mutation_partition_applier.hh"
@@ -232,6 +233,7 @@ table::table(schema_ptr schema, config config, db::commitlog* cl, compaction_man
     : _schema(std::move(schema))
     , _config(std::move(config))
     , _view_stats(format("{}_{}_view_replica_update", _schema->ks_name(), _schema->cf_name()))
+    , _view_update_coalescer(_config.view_update_coalescing_window, _view_stats)
     , _memtables(_config.enable_disk_writes ? make_memtable_list() : make_memory_only_memtable_list())
     , _streaming_memtables(_config.enable_disk_writes ? make_streaming_memtable_list() : make_memory_only_memtable_list())
     , _compaction_strategy(make_compaction_strategy(_schema->compaction_strategy(), _schema->compaction_strategy_options()))
@@ -895,6 +897,26 @@ table::update_cache(lw_shared_ptr<memtable> m, sstables::shared_sstable sst) {
     }
 }
 
+future<>
+table::update_cache(lw_shared_ptr<memtable> m, std::vector<sstables::shared_sstable> ssts) {
+    auto adder = [this, m, ssts = std::move(ssts)] {
+        std::vector<mutation_source> sources;
+        sources.reserve(ssts.size());
+        for (auto&& sst : ssts) {
+            sources.push_back(sst->as_mutation_source());
+            add_sstable(sst, {engine().cpu_id()});
+        }
+        m->mark_flushed(make_combined_mutation_source(std::move(sources)));
+        try_trigger_compaction();
+    };
+    if (_config.enable_cache) {
+        return _cache.update(adder, *m);
+    } else {
+        adder();
+        return m->clear_gently();
+    }
+}
+
 future<>
 table::seal_active_streaming_memtable_immediate(flush_permit&& permit) {
   return with_scheduling_group(_config.streaming_scheduling_group, [this, permit = std::move(permit)] () mutable {
@@ -1057,8 +1079,22 @@ table::seal_active_memtable(flush_permit&& permit) {
     // FIXME: provide back-pressure to upper layers
 }
 
+// Splitting a flush has a fixed cost per writer, and produces smaller sstables,
+// so each writer should get a reasonable amount of data.
+static constexpr size_t min_memtable_size_per_flush_writer = 16 << 20;
+
+unsigned
+table::memtable_flush_writers_for(const memtable& m) const {
+    auto writers = m.occupancy().used_space() / min_memtable_size_per_flush_writer;
+    return std::max<size_t>(1, std::min<size_t>(_config.memtable_flush_writers, writers));
+}
+
 future<stop_iteration>
 table::try_flush_memtable_to_sstable(lw_shared_ptr<memtable> old, sstable_write_permit&& permit) {
+  auto ranges = old->split_for_flush(memtable_flush_writers_for(*old));
+  if (ranges.size() > 1) {
+      return try_flush_memtable_to_sstable_run(std::move(old), std::move(permit), std::move(ranges));
+  }
   return with_scheduling_group(_config.memtable_scheduling_group, [this, old = std::move(old), permit = std::move(permit)] () mutable {
     auto gen = calculate_generation_for_new_table();
 
@@ -1113,6 +1149,72 @@ table::try_flush_memtable_to_sstable(lw_shared_ptr<memtable> old, sstable_write_
   });
 }
 
+future<stop_iteration>
+table::try_flush_memtable_to_sstable_run(lw_shared_ptr<memtable> old, sstable_write_permit&& permit, dht::partition_range_vector ranges) {
+  return with_scheduling_group(_config.memtable_scheduling_group, [this, old = std::move(old), permit = std::move(permit), ranges = std::move(ranges)] () mutable {
+    struct flush_writer {
+        dht::partition_range range;
+        sstables::shared_sstable sst;
+        database_sstable_write_monitor monitor;
+
+        flush_writer(dht::partition_range r, sstables::shared_sstable s, database_sstable_write_monitor m)
+            : range(std::move(r)), sst(std::move(s)), monitor(std::move(m)) {}
+    };
+    // The permit bounds the number of memtables being written concurrently, and
+    // is held until all the writers have written their data. The writers don't
+    // take a permit of their own, since they write parts of the same memtable.
+    std::vector<std::unique_ptr<flush_writer>> writers;
+    writers.reserve(ranges.size());
+    for (auto&& range : ranges) {
+        auto newtab = sstables::make_sstable(_schema,
+            _config.datadir, calculate_generation_for_new_table(),
+            get_highest_supported_format(),
+            sstables::sstable::format_types::big);
+        newtab->set_unshared();
+        writers.push_back(std::make_unique<flush_writer>(std::move(range), newtab,
+            database_sstable_write_monitor(sstable_write_permit::unconditional(), newtab, _compaction_manager, _compaction_strategy, old->get_max_timestamp())));
+    }
+    dblog.debug("Flushing memtable of {}.{} to a run of {} sstables", _schema->ks_name(), _schema->cf_name(), writers.size());
+    return do_with(std::move(writers), std::move(permit), [this, old] (auto& writers, auto& permit) {
+        auto&& priority = service::get_local_memtable_flush_priority();
+        auto run_identifier = utils::make_random_uuid();
+        auto estimated_partitions = old->partition_count() / writers.size() + 1;
+        auto f = parallel_for_each(writers, [this, old, &priority, run_identifier, estimated_partitions] (auto& w) {
+            return write_memtable_to_sstable(*old, w->sst, w->range, estimated_partitions, run_identifier, w->monitor,
+                    get_large_partition_handler(), incremental_backups_enabled(), priority);
+        });
+        // See try_flush_memtable_to_sstable() for why post-flush actions run in the default scheduling group.
+        return with_scheduling_group(default_scheduling_group(), [this, old, &writers, &permit, f = std::move(f)] () mutable {
+            return f.then([&writers, &permit] {
+                permit = sstable_write_permit::unconditional();
+                return parallel_for_each(writers, [] (auto& w) {
+                    return w->sst->open_data();
+                });
+            }).then([this, old, &writers] {
+                auto ssts = boost::copy_range<std::vector<sstables::shared_sstable>>(writers
+                        | boost::adaptors::transformed([] (auto& w) { return w->sst; }));
+                dblog.debug("Flushing memtable of {}.{} to a run of {} sstables done", _schema->ks_name(), _schema->cf_name(), ssts.size());
+                return with_scheduling_group(_config.memtable_to_cache_scheduling_group, [this, old, ssts = std::move(ssts)] () mutable {
+                    return update_cache(old, std::move(ssts));
+                });
+            }).then([this, old] () noexcept {
+                _memtables->erase(old);
+                return stop_iteration::yes;
+            }).handle_exception([this, old, &writers] (auto e) {
+                for (auto&& w : writers) {
+                    w->monitor.write_failed();
+                    w->sst->mark_for_deletion();
+                }
+                dblog.error("failed to write sstable run for {}.{}: {}", _schema->ks_name(), _schema->cf_name(), e);
+                // See try_flush_memtable_to_sstable().
+                old->revert_flushed_memory();
+                return stop_iteration(_async_gate.is_closed());
+            });
+        });
+    });
+  });
+}
+
 void
 table::start() {
     // FIXME: add option to disable automatic compaction.
@@ -1122,6 +1224,8 @@ table::start() {
 future<>
 table::stop() {
     return _async_gate.close().then([this] {
+        return _view_update_coalescer.stop();
+    }).then([this] {
         return when_all(_memtables->request_flush(), _streaming_memtables->request_flush()).discard_result().finally([this] {
             return _compaction_manager.remove(this).then([this] {
                 // Nest, instead of using when_all, so we don't lose any exceptions.
@@ -1300,6 +1404,7 @@ void table::set_metrics() {
                     ms::make_total_operations("view_updates_failed_remote", _view_stats.view_updates_failed_remote, ms::description("Number of updates (mutations) that failed to be pushed to remote view replicas"))(cf)(ks),
                     ms::make_total_operations("view_updates_pushed_local", _view_stats.view_updates_pushed_local, ms::description("Number of updates (mutations) pushed to local view replicas"))(cf)(ks),
                     ms::make_total_operations("view_updates_failed_local", _view_stats.view_updates_failed_local, ms::description("Number of updates (mutations) that failed to be pushed to local view replicas"))(cf)(ks),
+                    ms::make_total_operations("view_updates_coalesced", _view_stats.view_updates_coalesced, ms::description("Number of view updates merged into an already pending update to the same view partition"))(cf)(ks),
                     ms::make_gauge("view_updates_pending", ms::description("Number of updates pushed to view and are still to be completed"), _view_stats.writes)(cf)(ks),
             });
         }
@@ -2393,6 +2498,9 @@ database::setup_metrics() {
         sm::make_gauge("querier_cache_population", _querier_cache.get_stats().population,
                        sm::description("The number of entries currently in the querier cache.")),
 
+        sm::make_current_bytes("view_update_backlog", [this] { return get_view_update_backlog().current; },
+                       sm::description("Holds the current size in bytes of the pending view updates for all tables")),
+
         sm::make_derive("sstable_read_queue_overloads", _stats->sstable_read_queue_overloaded,
                        sm::description("Counts the number of times the sstable read queue was overloaded. "
                                        "A non-zero value indicates that we have to drop read requests because they arrive faster than we can serve them.")),
@@ -2947,6 +3055,7 @@ keyspace::make_column_family_config(const schema& s, const db::config& db_config
     cfg.enable_commitlog = _config.enable_commitlog;
     cfg.enable_cache = _config.enable_cache;
     cfg.compaction_enforce_min_threshold = _config.compaction_enforce_min_threshold;
+    cfg.memtable_flush_writers = db_config.memtable_flush_writers();
     cfg.dirty_memory_manager = _config.dirty_memory_manager;
     cfg.streaming_dirty_memory_manager = _config.streaming_dirty_memory_manager;
     cfg.read_concurrency_semaphore = _config.read_concurrency_semaphore;
@@ -2962,6 +3071,8 @@ keyspace::make_column_family_config(const schema& s, const db::config& db_config
     cfg.enable_metrics_reporting = db_config.enable_keyspace_column_family_metrics();
     cfg.large_partition_handler = lp_handler;
     cfg.view_update_concurrency_semaphore = _config.view_update_concurrency_semaphore;
+    cfg.view_update_concurrency_semaphore_limit = _config.view_update_concurrency_semaphore_limit;
+    cfg.view_update_coalescing_window = _config.view_update_coalescing_window;
 
     return cfg;
 }
@@ -3759,6 +3870,8 @@ database::make_keyspace_config(const keyspace_metadata& ksm) {
     cfg.enable_metrics_reporting = _cfg->enable_keyspace_column_family_metrics();
 
     cfg.view_update_concurrency_semaphore = &_view_update_concurrency_sem;
+    cfg.view_update_concurrency_semaphore_limit = max_memory_pending_view_updates();
+    cfg.view_update_coalescing_window = std::chrono::microseconds(_cfg->view_update_coalescing_window_in_us());
     return cfg;
 }
 
@@ -4499,9 +4612,16 @@ future<> table::generate_and_propagate_view_updates(const schema_ptr& base,
                         std::move(views),
                         flat_mutation_reader_from_mutations({std::move(m)}),
                         std::move(existings)).then([this, timeout, base_token = std::move(base_token)] (auto&& updates) mutable {
-        return seastar::get_units(*_config.view_update_concurrency_semaphore, 1, timeout).then(
+        // The units are held until the view replicas acknowledge the updates, so the
+        // semaphore accounts for the memory of all pending view updates of this shard.
+        // Cap the units, so that a single huge update doesn't block forever.
+        size_t memory = boost::accumulate(updates | boost::adaptors::transformed([] (const mutation& m) {
+            return m.partition().external_memory_usage(*m.schema());
+        }), size_t(0));
+        auto units = std::min(memory, _config.view_update_concurrency_semaphore_limit);
+        return seastar::get_units(*_config.view_update_concurrency_semaphore, units, timeout).then(
                 [this, base_token = std::move(base_token), updates = std::move(updates)] (auto units) mutable {
-            db::view::mutate_MV(std::move(base_token), std::move(updates), _view_stats).handle_exception([units = std::move(units)] (auto ignored) { });
+            _view_update_coalescer.add(std::move(base_token), std::move(updates), std::move(units));
         });
     });
 }
@@ -4803,6 +4923,21 @@ write_memtable_to_sstable(memtable& mt, sstables::shared_sstable sst,
         mt.schema(), cfg, mt.get_stats(), pc);
 }
 
+future<>
+write_memtable_to_sstable(memtable& mt, sstables::shared_sstable sst, const dht::partition_range& range,
+                          uint64_t estimated_partitions, utils::UUID run_identifier,
+                          sstables::write_monitor& monitor, db::large_partition_handler* lp_handler,
+                          bool backup, const io_priority_class& pc) {
+    sstables::sstable_writer_config cfg;
+    cfg.replay_position = mt.replay_position();
+    cfg.backup = backup;
+    cfg.monitor = &monitor;
+    cfg.large_partition_handler = lp_handler;
+    cfg.run_identifier = run_identifier;
+    return sst->write_components(mt.make_flush_reader(mt.schema(), pc, range), estimated_partitions,
+        mt.schema(), cfg, mt.get_stats(), pc);
+}
+
 future<>
 write_memtable_to_sstable(memtable& mt, sstables::shared_sstable sst, db::large_partition_handler* lp_handler) {
     return do_with(permit_monitor(sstable_write_permit::unconditional()), [&mt, sst, lp_handler] (auto& monitor) {
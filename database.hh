@@ -77,6 +77,7 @@
 #include <seastar/core/metrics_registration.hh>
 #include "tracing/trace_state.hh"
 #include "db/view/view.hh"
+#include "db/view/view_update_backlog.hh"
 #include "db/view/row_locking.hh"
 #include "lister.hh"
 #include "utils/phased_barrier.hh"
@@ -311,6 +312,7 @@ class table : public enable_lw_shared_from_this<table> {
         bool enable_commitlog = true;
         bool enable_incremental_backups = false;
         bool compaction_enforce_min_threshold = false;
+        unsigned memtable_flush_writers = 1;
         ::dirty_memory_manager* dirty_memory_manager = &default_dirty_memory_manager;
         ::dirty_memory_manager* streaming_dirty_memory_manager = &default_dirty_memory_manager;
         reader_concurrency_semaphore* read_concurrency_semaphore;
@@ -325,6 +327,8 @@ class table : public enable_lw_shared_from_this<table> {
         bool enable_metrics_reporting = false;
         db::large_partition_handler* large_partition_handler;
         db::timeout_semaphore* view_update_concurrency_semaphore;
+        size_t view_update_concurrency_semaphore_limit = 0;
+        std::chrono::microseconds view_update_coalescing_window{0};
     };
     struct no_commitlog {};
     struct stats {
@@ -360,6 +364,7 @@ class table : public enable_lw_shared_from_this<table> {
     config _config;
     mutable stats _stats;
     mutable db::view::stats _view_stats;
+    mutable db::view::view_update_coalescer _view_update_coalescer;
     mutable row_locker::stats _row_locker_stats;
 
     uint64_t _failed_counter_applies_to_memtable = 0;
@@ -511,8 +516,13 @@ class table : public enable_lw_shared_from_this<table> {
     lw_shared_ptr<memtable> new_memtable();
     lw_shared_ptr<memtable> new_streaming_memtable();
     future<stop_iteration> try_flush_memtable_to_sstable(lw_shared_ptr<memtable> memt, sstable_write_permit&& permit);
+    // Flushes each of the ranges by a separate, concurrent writer, producing a run of sstables.
+    future<stop_iteration> try_flush_memtable_to_sstable_run(lw_shared_ptr<memtable> memt, sstable_write_permit&& permit,
+            dht::partition_range_vector ranges);
+    unsigned memtable_flush_writers_for(const memtable& m) const;
     // Caller must keep m alive.
     future<> update_cache(lw_shared_ptr<memtable> m, sstables::shared_sstable sst);
+    future<> update_cache(lw_shared_ptr<memtable> m, std::vector<sstables::shared_sstable> ssts);
     struct merge_comparator;
 
     // update the sstable generation, making sure that new new sstables don't overwrite this one.
@@ -1084,6 +1094,8 @@ class keyspace {
         seastar::scheduling_group streaming_scheduling_group;
         bool enable_metrics_reporting = false;
         db::timeout_semaphore* view_update_concurrency_semaphore = nullptr;
+        size_t view_update_concurrency_semaphore_limit = 0;
+        std::chrono::microseconds view_update_coalescing_window{0};
     };
 private:
     std::unique_ptr<locator::abstract_replication_strategy> _replication_strategy;
@@ -1185,6 +1197,9 @@ class database {
     static const size_t max_count_system_concurrent_reads{10};
     size_t max_memory_system_concurrent_reads() { return _dbcfg.available_memory * 0.02; };
     static constexpr size_t max_concurrent_sstable_loads() { return 3; }
+    // Base writes block once the view updates they generated and which were
+    // not yet acknowledged by the view replicas take up this much memory.
+    size_t max_memory_pending_view_updates() const { return _dbcfg.available_memory * 0.1; }
 
     struct db_stats {
         uint64_t total_writes = 0;
@@ -1221,7 +1236,7 @@ class database {
 
     semaphore _sstable_load_concurrency_sem{max_concurrent_sstable_loads()};
 
-    db::timeout_semaphore _view_update_concurrency_sem{100}; // Stand-in hack for #2538
+    db::timeout_semaphore _view_update_concurrency_sem{max_memory_pending_view_updates()};
 
     cache_tracker _row_cache_tracker;
 
@@ -1450,6 +1465,12 @@ class database {
         _querier_cache.set_entry_ttl(entry_ttl);
     }
 
+    db::view::update_backlog get_view_update_backlog() const {
+        auto max = max_memory_pending_view_updates();
+        auto available = size_t(std::max(_view_update_concurrency_sem.available_units(), ssize_t(0)));
+        return {max - std::min(max, available), std::max(max, size_t(1))};
+    }
+
     const query::querier_cache::stats& get_querier_cache_stats() const {
         return _querier_cache.get_stats();
     }
@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2018 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <seastar/core/byteorder.hh>
+#include <seastar/core/fstream.hh>
+#include <seastar/core/metrics.hh>
+#include <seastar/core/sleep.hh>
+#include <seastar/core/thread.hh>
+
+#include "db/cache_warmer.hh"
+#include "database.hh"
+#include "disk-error-handler.hh"
+#include "lister.hh"
+#include "log.hh"
+#include "service/priority_manager.hh"
+#include "utils/serialization.hh"
+
+namespace db {
+
+static logging::logger cwlogger("cache_warmer");
+
+// File format, all integers are big-endian:
+//
+//   magic:u32 version:u32 count:u32 { table_id_msb:u64 table_id_lsb:u64 key_size:u32 key:bytes[key_size] }*count
+//
+static constexpr uint32_t file_magic = 0x53484b31; // "SHK1"
+static constexpr uint32_t file_version = 1;
+
+// How many LRU entries cache_tracker::hot_partitions() looks at, per saved
+// key and in total. It walks them under a reclaim lock and without
+// preemption, so the total has to stay small.
+static constexpr size_t rows_scanned_per_key = 16;
+static constexpr size_t max_rows_scanned = 4096;
+
+const sstring cache_warmer::file_prefix = "hot_partitions-";
+const sstring cache_warmer::file_suffix = ".db";
+
+cache_warmer::cache_warmer(database& db, config cfg)
+    : _db(db)
+    , _cfg(std::move(cfg))
+    , _save_timer([this] { (void)_save_action.trigger_later(); })
+    , _save_action([this] { return do_save(); })
+{
+    setup_metrics();
+}
+
+void cache_warmer::setup_metrics() {
+    namespace sm = seastar::metrics;
+    _metrics.add_group("cache_warmer", {
+        sm::make_derive("saves", _stats.saves,
+                sm::description("number of times the keys of the hottest partitions were saved")),
+        sm::make_derive("save_errors", _stats.save_errors,
+                sm::description("number of failed attempts to save the keys of the hottest partitions")),
+        sm::make_gauge("keys_saved", _stats.keys_saved,
+                sm::description("number of partition keys written by the last save")),
+        sm::make_derive("warmup_partitions_found", _stats.warmup_partitions_found,
+                sm::description("number of saved partitions owned by this shard found during warm-up")),
+        sm::make_derive("warmup_partitions_loaded", _stats.warmup_partitions_loaded,
+                sm::description("number of saved partitions read into cache during warm-up")),
+        sm::make_derive("warmup_partitions_skipped", _stats.warmup_partitions_skipped,
+                sm::description("number of saved partitions skipped during warm-up because their table no longer exists")),
+        sm::make_derive("warmup_bytes", _stats.warmup_bytes,
+                sm::description("number of bytes read into cache during warm-up")),
+        sm::make_gauge("warmup_done", [this] { return _stats.warmup_done ? 1 : 0; },
+                sm::description("1 if the cache warm-up has finished, 0 otherwise")),
+    });
+}
+
+sstring cache_warmer::file_name(unsigned shard) const {
+    return sprint("%s/%s%d%s", _cfg.directory, file_prefix, shard, file_suffix);
+}
+
+future<> cache_warmer::start() {
+    if (_cfg.save_period.count()) {
+        _save_timer.arm_periodic(_cfg.save_period);
+    }
+    // Warm-up runs in the background; failures only cost us a colder cache.
+    (void)warm_up().handle_exception([] (std::exception_ptr ep) {
+        cwlogger.warn("Cache warm-up failed: {}", ep);
+    });
+    return make_ready_future<>();
+}
+
+future<> cache_warmer::stop() {
+    _save_timer.cancel();
+    _as.request_abort();
+    // The cache is at its hottest right before a restart, save it one last time.
+    auto f = _cfg.save_period.count() ? _save_action.trigger() : _save_action.join();
+    return f.then([this] {
+        return _gate.close();
+    });
+}
+
+future<> cache_warmer::save() {
+    return _save_action.trigger();
+}
+
+future<> cache_warmer::do_save() {
+    if (_gate.is_closed()) {
+        return make_ready_future<>();
+    }
+    return with_gate(_gate, [this] {
+        auto keys = _db.row_cache_tracker().hot_partitions(_cfg.keys_to_save,
+                std::min(_cfg.keys_to_save * rows_scanned_per_key, max_rows_scanned));
+        return seastar::async([this, keys = std::move(keys)] {
+            std::vector<char> buf;
+            auto out = std::back_inserter(buf);
+            serialize_int32(out, file_magic);
+            serialize_int32(out, file_version);
+            serialize_int32(out, keys.size());
+            for (auto&& hp : keys) {
+                serialize_int64(out, hp.table_id.get_most_significant_bits());
+                serialize_int64(out, hp.table_id.get_least_significant_bits());
+                auto key = hp.key.representation();
+                serialize_int32(out, key.size());
+                out = std::copy(key.begin(), key.end(), out);
+            }
+
+            // Write to a temporary file and rename it, so that a crash in the
+            // middle leaves the previous list intact.
+            auto path = file_name(engine().cpu_id());
+            auto tmp_path = path + ".tmp";
+            auto flags = open_flags::wo | open_flags::create | open_flags::truncate;
+            auto f = open_checked_file_dma(general_disk_error_handler, tmp_path, flags).get0();
+            auto os = make_file_output_stream(std::move(f));
+            os.write(buf.data(), buf.size()).get();
+            os.flush().get();
+            os.close().get();
+            io_check(rename_file, tmp_path, path).get();
+            io_check(sync_directory, _cfg.directory).get();
+
+            ++_stats.saves;
+            _stats.keys_saved = keys.size();
+            cwlogger.debug("Saved {} hot partition keys to {}", keys.size(), path);
+        }).handle_exception([this] (std::exception_ptr ep) {
+            ++_stats.save_errors;
+            cwlogger.warn("Failed to save hot partition keys: {}", ep);
+        });
+    });
+}
+
+future<> cache_warmer::warm_up() {
+    return with_gate(_gate, [this] {
+        return with_scheduling_group(_cfg.scheduling_group, [this] {
+            return seastar::async([this] {
+                std::vector<sstring> files;
+                lister::scan_dir(_cfg.directory, { directory_entry_type::regular }, [&files] (fs::path dir, directory_entry de) {
+                    files.push_back((dir / de.name.c_str()).native());
+                    return make_ready_future<>();
+                }, [] (const fs::path&, const directory_entry& de) {
+                    return boost::starts_with(de.name, file_prefix) && boost::ends_with(de.name, file_suffix);
+                }).get();
+
+                for (auto&& path : files) {
+                    if (_as.abort_requested()) {
+                        return;
+                    }
+                    try {
+                        warm_up_from(path);
+                    } catch (const seastar::sleep_aborted&) {
+                        return;
+                    } catch (...) {
+                        cwlogger.warn("Failed to warm up cache from {}: {}", path, std::current_exception());
+                    }
+                }
+                _stats.warmup_done = true;
+                cwlogger.info("Cache warm-up done: loaded {} partitions, {} bytes",
+                        _stats.warmup_partitions_loaded, _stats.warmup_bytes);
+            });
+        });
+    });
+}
+
+void cache_warmer::warm_up_from(sstring path) {
+    auto f = open_checked_file_dma(general_disk_error_handler, path, open_flags::ro).get0();
+    auto in = make_file_input_stream(std::move(f));
+    std::exception_ptr ex;
+    try {
+        warm_up_from(path, in);
+    } catch (...) {
+        ex = std::current_exception();
+    }
+    in.close().get();
+    if (ex) {
+        std::rethrow_exception(std::move(ex));
+    }
+}
+
+void cache_warmer::warm_up_from(const sstring& path, input_stream<char>& in) {
+    auto read_exactly = [&in, &path] (size_t n) {
+        auto buf = in.read_exactly(n).get0();
+        if (buf.size() != n) {
+            throw std::runtime_error(sprint("%s: unexpected end of file", path));
+        }
+        return buf;
+    };
+    auto read_u32 = [&] { return read_be<uint32_t>(read_exactly(serialize_int32_size).get()); };
+    auto read_u64 = [&] { return read_be<uint64_t>(read_exactly(serialize_int64_size).get()); };
+
+    if (read_u32() != file_magic || read_u32() != file_version) {
+        throw std::runtime_error(sprint("%s: unrecognized file format", path));
+    }
+    auto count = read_u32();
+
+    auto start = lowres_clock::now();
+    uint64_t total_bytes = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        auto msb = read_u64();
+        auto lsb = read_u64();
+        auto key_size = read_u32();
+        auto key = partition_key::from_bytes(to_bytes(bytes_view(reinterpret_cast<const int8_t*>(read_exactly(key_size).get()), key_size)));
+
+        lw_shared_ptr<table> t;
+        try {
+            t = _db.find_column_family(utils::UUID(msb, lsb)).shared_from_this();
+        } catch (const no_such_column_family&) {
+            ++_stats.warmup_partitions_skipped;
+            continue;
+        }
+        schema_ptr s = t->schema();
+        auto dk = dht::global_partitioner().decorate_key(*s, std::move(key));
+        if (dht::shard_of(dk.token()) != engine().cpu_id()) {
+            continue;
+        }
+        ++_stats.warmup_partitions_found;
+
+        // Reading through the cache populates it, like a regular read would.
+        auto pr = dht::partition_range::make_singular(dk);
+        auto reader = t->get_row_cache().make_reader(s, pr, s->full_slice(), service::get_local_streaming_read_priority());
+        uint64_t bytes = 0;
+        while (auto mfopt = reader(db::no_timeout).get0()) {
+            bytes += mfopt->memory_usage(*s);
+        }
+        ++_stats.warmup_partitions_loaded;
+        _stats.warmup_bytes += bytes;
+        total_bytes += bytes;
+
+        if (_cfg.warmup_bandwidth) {
+            auto expected = std::chrono::duration_cast<lowres_clock::duration>(
+                    std::chrono::duration<double>(double(total_bytes) / _cfg.warmup_bandwidth));
+            auto elapsed = lowres_clock::now() - start;
+            if (expected > elapsed) {
+                sleep_abortable(expected - elapsed, _as).get();
+            }
+        }
+        if (_as.abort_requested()) {
+            break;
+        }
+    }
+}
+
+}
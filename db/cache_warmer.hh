@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2018 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <seastar/core/abort_source.hh>
+#include <seastar/core/gate.hh>
+#include <seastar/core/iostream.hh>
+#include <seastar/core/metrics_registration.hh>
+#include <seastar/core/scheduling.hh>
+#include <seastar/core/timer.hh>
+
+#include "seastarx.hh"
+#include "row_cache.hh"
+#include "utils/serialized_action.hh"
+
+class database;
+
+namespace db {
+
+// Saves the keys of the hottest partitions in the row cache and reads those
+// partitions back into the cache after a restart, so that a restarted node
+// doesn't start serving reads with a cold cache.
+//
+// Each shard periodically saves the keys ranked highest by
+// cache_tracker::hot_partitions() to its own file in saved_caches_directory.
+// On startup, each shard goes over all saved files and populates its cache
+// with the partitions it owns, so warm-up works even if the number of shards
+// changed across the restart. Warm-up runs in the background, in the given
+// scheduling group, with streaming I/O priority and at a throttled rate.
+class cache_warmer {
+public:
+    struct config {
+        sstring directory;
+        // Zero disables saving.
+        std::chrono::seconds save_period;
+        size_t keys_to_save;
+        // In bytes per second, zero disables throttling.
+        size_t warmup_bandwidth;
+        seastar::scheduling_group scheduling_group;
+    };
+    struct stats {
+        uint64_t saves = 0;
+        uint64_t save_errors = 0;
+        uint64_t keys_saved = 0;
+        uint64_t warmup_partitions_found = 0;
+        uint64_t warmup_partitions_loaded = 0;
+        uint64_t warmup_partitions_skipped = 0;
+        uint64_t warmup_bytes = 0;
+        bool warmup_done = false;
+    };
+    static const sstring file_prefix;
+    static const sstring file_suffix;
+private:
+    database& _db;
+    config _cfg;
+    stats _stats;
+    timer<lowres_clock> _save_timer;
+    serialized_action _save_action;
+    seastar::abort_source _as;
+    seastar::gate _gate;
+    seastar::metrics::metric_groups _metrics;
+private:
+    void setup_metrics();
+    sstring file_name(unsigned shard) const;
+    future<> do_save();
+    // Must be called in a seastar::thread.
+    void warm_up_from(sstring path);
+    void warm_up_from(const sstring& path, input_stream<char>& in);
+public:
+    cache_warmer(database& db, config cfg);
+
+    // Starts the background warm-up from the saved files and the periodic saving.
+    future<> start();
+    future<> stop();
+
+    // Saves the keys of this shard's hottest partitions.
+    future<> save();
+
+    // Populates this shard's cache with the partitions from all saved files.
+    // Resolves when done.
+    future<> warm_up();
+
+    const stats& get_stats() const {
+        return _stats;
+    }
+};
+
+}
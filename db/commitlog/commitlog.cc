@@ -48,6 +48,7 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <exception>
+#include <lz4.h>
 
 #include <seastar/core/align.hh>
 #include <seastar/core/reactor.hh>
@@ -61,6 +62,7 @@
 #include <seastar/core/chunked_fifo.hh>
 #include <seastar/core/queue.hh>
 #include <seastar/core/sleep.hh>
+#include <seastar/core/byteorder.hh>
 #include <seastar/net/byteorder.hh>
 
 #include "seastarx.hh"
@@ -128,7 +130,17 @@ db::commitlog::config db::commitlog::config::from_db_config(const db::config& cf
     c.commitlog_total_space_in_mb = cfg.commitlog_total_space_in_mb() >= 0 ? cfg.commitlog_total_space_in_mb() : (shard_available_memory * smp::count) >> 20;
     c.commitlog_segment_size_in_mb = cfg.commitlog_segment_size_in_mb();
     c.commitlog_sync_period_in_ms = cfg.commitlog_sync_period_in_ms();
-    c.mode = cfg.commitlog_sync() == "batch" ? sync_mode::BATCH : sync_mode::PERIODIC;
+    c.commitlog_sync_group_window_in_us = cfg.commitlog_sync_group_window_in_us();
+    c.reuse_segments = cfg.commitlog_reuse_segments();
+    c.use_o_dsync = cfg.commitlog_use_o_dsync();
+    c.use_compression = cfg.commitlog_compression();
+    if (cfg.commitlog_sync() == "batch") {
+        c.mode = sync_mode::BATCH;
+    } else if (cfg.commitlog_sync() == "group") {
+        c.mode = sync_mode::GROUP;
+    } else {
+        c.mode = sync_mode::PERIODIC;
+    }
     c.extensions = &cfg.extensions();
 
     return c;
@@ -233,16 +245,66 @@ class db::commitlog::segment_manager : public ::enable_shared_from_this<segment_
         uint64_t bytes_slack = 0;
         uint64_t segments_created = 0;
         uint64_t segments_destroyed = 0;
+        uint64_t segments_recycled = 0;
+        uint64_t segments_reused = 0;
         uint64_t pending_flushes = 0;
         uint64_t flush_limit_exceeded = 0;
         uint64_t total_size = 0;
         uint64_t buffer_list_bytes = 0;
         uint64_t total_size_on_disk = 0;
         uint64_t requests_blocked_memory = 0;
+        uint64_t group_syncs = 0;
+        uint64_t group_sync_writes = 0;
+        uint64_t group_sync_latency_us = 0;
+        uint64_t compression_input_bytes = 0;
+        uint64_t compression_output_bytes = 0;
+        uint64_t compression_time_us = 0;
     };
 
     stats totals;
 
+    // Group commit window adaptation. A write opening a group waits for
+    // others no longer than a sync is observed to take, since writes arriving
+    // during a sync are picked up by the next group anyway. It doesn't wait
+    // at all if no other write is expected to arrive in the meantime.
+    using group_clock_type = steady_clock_type;
+    std::chrono::microseconds _group_sync_latency{0};
+    double _group_arrival_rate = 0; // writes per microsecond
+    group_clock_type::time_point _last_group_open;
+    uint64_t _group_writes_at_last_open = 0;
+
+    static double ewma(double avg, double sample) {
+        return avg + (sample - avg) / 4;
+    }
+
+    std::chrono::microseconds group_sync_window() const {
+        auto window = std::min(std::chrono::microseconds(cfg.commitlog_sync_group_window_in_us), _group_sync_latency);
+        if (_group_arrival_rate * window.count() < 1) {
+            return std::chrono::microseconds(0);
+        }
+        return window;
+    }
+
+    // Called when a write opens a new group, returns how long the group should wait for more writes.
+    std::chrono::microseconds open_group_sync() {
+        auto now = group_clock_type::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - _last_group_open).count();
+        if (elapsed > 0) {
+            auto writes = totals.group_sync_writes - _group_writes_at_last_open;
+            _group_arrival_rate = ewma(_group_arrival_rate, double(writes) / elapsed);
+        }
+        _last_group_open = now;
+        _group_writes_at_last_open = totals.group_sync_writes;
+        return group_sync_window();
+    }
+
+    void on_group_sync(group_clock_type::duration latency) {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(latency);
+        _group_sync_latency = std::chrono::microseconds(int64_t(ewma(_group_sync_latency.count(), us.count())));
+        ++totals.group_syncs;
+        totals.group_sync_latency_us += us.count();
+    }
+
     size_t pending_allocations() const {
         return _request_controller.waiters();
     }
@@ -297,6 +359,12 @@ class db::commitlog::segment_manager : public ::enable_shared_from_this<segment_
     future<> do_pending_deletes();
 
     future<> delete_segments(std::vector<sstring>);
+    future<> recycle_segments(std::vector<sstring>);
+    future<> zero_fill_segment(file);
+    bool reuse_segments() const {
+        // Extensions may keep per-file state, don't pass their files on to new segments.
+        return cfg.reuse_segments && !(cfg.extensions && !cfg.extensions->commitlog_file_extensions().empty());
+    }
 
     void discard_unused_segments();
     void discard_completed_segments(const cf_id_type&);
@@ -345,6 +413,9 @@ class db::commitlog::segment_manager : public ::enable_shared_from_this<segment_
     future<> _reserve_replenisher;
     seastar::gate _gate;
     uint64_t _new_counter = 0;
+    // Zeroed files of discarded segments, ready for reuse.
+    std::vector<sstring> _recycled_segments;
+    size_t _segments_being_recycled = 0;
 };
 
 template<typename T, typename Output>
@@ -424,6 +495,13 @@ class db::commitlog::segment : public enable_shared_from_this<segment>, public c
 
     uint64_t _num_allocs = 0;
 
+    // Group commit state, see group_cycle().
+    using group_sync_promise = shared_promise<with_clock<db::timeout_clock>>;
+    lw_shared_ptr<group_sync_promise> _group_sync;
+    timer<segment_manager::group_clock_type> _group_sync_timer;
+    bool _group_sync_running = false;
+    bool _group_sync_deferred = false;
+
     std::unordered_set<table_schema_version> _known_schema_versions;
 
     friend std::ostream& operator<<(std::ostream&, const segment&);
@@ -467,6 +545,7 @@ class db::commitlog::segment : public enable_shared_from_this<segment>, public c
             : _segment_manager(std::move(m)), _desc(std::move(d)), _file(std::move(f)),
         _file_name(_segment_manager->cfg.commit_log_location + "/" + _desc.filename()), _sync_time(
                     clock_type::now()), _pending_ops(true) // want exception propagation
+        , _group_sync_timer([this] { group_sync(); })
     {
         ++_segment_manager->totals.segments_created;
         clogger.debug("Created new {} segment {}", active ? "active" : "reserve", *this);
@@ -504,7 +583,7 @@ class db::commitlog::segment : public enable_shared_from_this<segment>, public c
     }
 
     bool must_sync() {
-        if (_segment_manager->cfg.mode == sync_mode::BATCH) {
+        if (_segment_manager->cfg.mode != sync_mode::PERIODIC) {
             return false;
         }
         auto now = clock_type::now();
@@ -521,7 +600,13 @@ class db::commitlog::segment : public enable_shared_from_this<segment>, public c
      */
     future<sseg_ptr> finish_and_get_new(db::timeout_clock::time_point timeout) {
         _closed = true;
-        sync();
+        if (_segment_manager->cfg.mode == sync_mode::GROUP) {
+            // Every write to the segment belongs to a group, and is flushed
+            // by that group's sync.
+            group_sync();
+        } else {
+            sync();
+        }
         return _segment_manager->active_segment(timeout);
     }
     void reset_sync_time() {
@@ -541,7 +626,15 @@ class db::commitlog::segment : public enable_shared_from_this<segment>, public c
             auto me = shared_from_this();
             return _gate.close().then([me] {
                 me->_closed = true;
-                return me->sync().finally([me] {
+                me->_group_sync_timer.cancel();
+                return me->sync().then([me] (sseg_ptr s) {
+                    // Nothing can be added anymore, so the final sync
+                    // covers all writes of a pending group.
+                    if (me->_group_sync) {
+                        std::exchange(me->_group_sync, nullptr)->set_value();
+                    }
+                    return s;
+                }).finally([me] {
                     // When we get here, nothing should add ops,
                     // and we should have waited out all pending.
                     return me->_pending_ops.close().finally([me] {
@@ -586,6 +679,14 @@ class db::commitlog::segment : public enable_shared_from_this<segment>, public c
                 clogger.trace("{} already synced! ({} < {})", *this, pos, _flush_pos);
                 return make_ready_future<>();
             }
+            if (_segment_manager->cfg.use_o_dsync) {
+                // All writes below pos have completed, and with O_DSYNC
+                // that means they are on disk already.
+                _flush_pos = std::max(pos, _flush_pos);
+                ++_segment_manager->totals.flush_count;
+                clogger.trace("{} synced to {}", *this, _flush_pos);
+                return make_ready_future<>();
+            }
             return _file.flush().then_wrapped([this, pos](future<> f) {
                 try {
                     f.get();
@@ -766,6 +867,90 @@ class db::commitlog::segment : public enable_shared_from_this<segment>, public c
         });
     }
 
+    future<sseg_ptr> group_cycle(timeout_clock::time_point timeout) {
+        /**
+         * For group mode, writes wait on a shared barrier, which is
+         * released by a single write and flush of everything added before
+         * it closed. A group closes when its window expires, or when the
+         * buffer is full. While a sync is running, the next group keeps
+         * collecting writes until it is done.
+         */
+        if (!_group_sync) {
+            _group_sync = make_lw_shared<group_sync_promise>();
+            _group_sync_timer.arm(_segment_manager->open_group_sync());
+        }
+        ++_segment_manager->totals.group_sync_writes;
+        auto f = _group_sync->get_shared_future(timeout);
+        if (buffer_position() >= default_size) {
+            group_sync();
+        }
+        return f.then([me = shared_from_this()] {
+            return make_ready_future<sseg_ptr>(me);
+        });
+    }
+
+    void group_sync() {
+        if (!_group_sync) {
+            return;
+        }
+        _group_sync_timer.cancel();
+        if (_group_sync_running) {
+            _group_sync_deferred = true;
+            return;
+        }
+        _group_sync_running = true;
+        auto pr = std::exchange(_group_sync, nullptr);
+        auto start = segment_manager::group_clock_type::now();
+        (void)sync().then_wrapped([me = shared_from_this(), pr = std::move(pr), start] (future<sseg_ptr> f) {
+            me->_group_sync_running = false;
+            if (f.failed()) {
+                // Same as in batch mode, assume an IO error and stop using the segment.
+                me->_closed = true;
+                pr->set_exception(f.get_exception());
+            } else {
+                f.ignore_ready_future();
+                me->_segment_manager->on_group_sync(segment_manager::group_clock_type::now() - start);
+                pr->set_value();
+            }
+            if (std::exchange(me->_group_sync_deferred, false)) {
+                me->group_sync();
+            }
+        });
+    }
+
+    /**
+     * Serializes an entry and compresses it. The result is the uncompressed
+     * size, followed by the LZ4-compressed data, or by the data as is if it
+     * doesn't compress, so it is never more than sizeof(uint32_t) bigger
+     * than the entry.
+     */
+    temporary_buffer<char> compress_entry(entry_writer& writer, size_t size) {
+        auto start = std::chrono::steady_clock::now();
+        temporary_buffer<char> data(size);
+        auto data_out = output::simple(data.get_write(), size);
+        writer.write(*this, data_out);
+
+        auto bound = LZ4_compressBound(size);
+        temporary_buffer<char> payload(sizeof(uint32_t) + bound);
+        write_be<uint32_t>(payload.get_write(), size);
+#ifdef SEASTAR_HAVE_LZ4_COMPRESS_DEFAULT
+        auto len = LZ4_compress_default(data.get(), payload.get_write() + sizeof(uint32_t), size, bound);
+#else
+        auto len = LZ4_compress(data.get(), payload.get_write() + sizeof(uint32_t), size);
+#endif
+        if (len <= 0 || size_t(len) >= size) {
+            std::copy_n(data.get(), size, payload.get_write() + sizeof(uint32_t));
+            len = size;
+        }
+        payload.trim(sizeof(uint32_t) + len);
+
+        auto& totals = _segment_manager->totals;
+        totals.compression_input_bytes += size;
+        totals.compression_output_bytes += payload.size();
+        totals.compression_time_us += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        return payload;
+    }
+
     /**
      * Add a "mutation" to the segment.
      */
@@ -777,7 +962,9 @@ class db::commitlog::segment : public enable_shared_from_this<segment>, public c
         }
 
         const auto size = writer->size(*this);
-        const auto s = size + entry_overhead_size; // total size
+        // Entries of a compressed segment are prefixed by their uncompressed size.
+        const auto payload_overhead = _desc.compressed() ? sizeof(uint32_t) : 0;
+        const auto s = size + payload_overhead + entry_overhead_size; // total size, at most
         auto ep = _segment_manager->sanity_check_size(s);
         if (ep) {
             return make_exception_future<rp_handle>(std::move(ep));
@@ -804,7 +991,13 @@ class db::commitlog::segment : public enable_shared_from_this<segment>, public c
             }
         }
 
-        size_t buf_memory = s;
+        temporary_buffer<char> payload;
+        if (_desc.compressed()) {
+            payload = compress_entry(*writer, size);
+        }
+        const auto entry_size = _desc.compressed() ? payload.size() + entry_overhead_size : s;
+
+        size_t buf_memory = entry_size;
         if (_buffer.empty()) {
             new_buffer(s);
             buf_memory += buffer_position();
@@ -819,20 +1012,25 @@ class db::commitlog::segment : public enable_shared_from_this<segment>, public c
 
         rp_handle h(static_pointer_cast<cf_holder>(shared_from_this()), std::move(id), rp);
 
-        auto out = _buffer_ostream.write_substream(s);
+        auto out = _buffer_ostream.write_substream(entry_size);
         crc32_nbo crc;
 
-        write<uint32_t>(out, s);
-        crc.process(uint32_t(s));
+        write<uint32_t>(out, entry_size);
+        crc.process(uint32_t(entry_size));
         write<uint32_t>(out, crc.checksum());
 
         // actual data
-        auto entry_out = out.write_substream(size);
-        auto entry_data = entry_out.to_input_stream();
-        writer->write(*this, entry_out);
-        entry_data.with_stream([&] (auto data_str) {
-            crc.process_fragmented(ser::buffer_view<typename std::vector<temporary_buffer<char>>::iterator>(data_str));
-        });
+        if (_desc.compressed()) {
+            out.write(payload.get(), payload.size());
+            crc.process_bytes(payload.get(), payload.size());
+        } else {
+            auto entry_out = out.write_substream(size);
+            auto entry_data = entry_out.to_input_stream();
+            writer->write(*this, entry_out);
+            entry_data.with_stream([&] (auto data_str) {
+                crc.process_fragmented(ser::buffer_view<typename std::vector<temporary_buffer<char>>::iterator>(data_str));
+            });
+        }
 
         write<uint32_t>(out, crc.checksum());
 
@@ -845,6 +1043,10 @@ class db::commitlog::segment : public enable_shared_from_this<segment>, public c
             return batch_cycle(timeout).then([h = std::move(h)](auto s) mutable {
                 return make_ready_future<rp_handle>(std::move(h));
             });
+        } else if (_segment_manager->cfg.mode == sync_mode::GROUP) {
+            return group_cycle(timeout).then([h = std::move(h)](auto s) mutable {
+                return make_ready_future<rp_handle>(std::move(h));
+            });
         } else {
             // If this buffer alone is too big, potentially bigger than the maximum allowed size,
             // then no other request will be allowed in to force the cycle()ing of this buffer. We
@@ -1145,6 +1347,40 @@ void db::commitlog::segment_manager::create_counters(const sstring& metrics_cate
 
         sm::make_gauge("memory_buffer_bytes", totals.buffer_list_bytes,
                        sm::description("Holds the total number of bytes in internal memory buffers.")),
+
+        sm::make_derive("segments_recycled", totals.segments_recycled,
+                       sm::description("Counts a number of discarded segment files which were zeroed and kept for reuse.")),
+
+        sm::make_derive("segments_reused", totals.segments_reused,
+                       sm::description("Counts a number of new segments which reused the file of a discarded one.")),
+
+        sm::make_derive("group_syncs", totals.group_syncs,
+                       sm::description("Counts a number of syncs shared by a group of writes in \"group\" mode. "
+                                       "Divide group_sync_writes by this value to get the average group size.")),
+
+        sm::make_derive("group_sync_writes", totals.group_sync_writes,
+                       sm::description("Counts a number of writes which waited for a group sync in \"group\" mode.")),
+
+        sm::make_derive("group_sync_latency_us", totals.group_sync_latency_us,
+                       sm::description("Counts the total time in microseconds spent in group syncs. "
+                                       "Divide this value by group_syncs to get the average sync latency.")),
+
+        sm::make_gauge("group_sync_window_us", [this] { return group_sync_window().count(); },
+                       sm::description("Holds the current adaptive window, in microseconds, for which a group of writes waits for more writes before syncing.")),
+
+        sm::make_derive("compression_input_bytes", totals.compression_input_bytes,
+                       sm::description("Counts a number of entry bytes given to compression.")),
+
+        sm::make_derive("compression_output_bytes", totals.compression_output_bytes,
+                       sm::description("Counts a number of entry bytes written after compression.")),
+
+        sm::make_gauge("compression_ratio", [this] {
+                           return totals.compression_input_bytes ? double(totals.compression_output_bytes) / totals.compression_input_bytes : 1.0;
+                       },
+                       sm::description("Holds the ratio of compressed to uncompressed entry sizes so far. Lower is better.")),
+
+        sm::make_derive("compression_time_us", totals.compression_time_us,
+                       sm::description("Counts the total time in microseconds spent compressing entries.")),
     });
 }
 
@@ -1188,17 +1424,36 @@ void db::commitlog::segment_manager::flush_segments(bool force) {
 }
 
 future<db::commitlog::segment_manager::sseg_ptr> db::commitlog::segment_manager::allocate_segment(bool active) {
-    static const auto flags = open_flags::wo | open_flags::create;
+    const auto flags = open_flags::wo | open_flags::create | (cfg.use_o_dsync ? open_flags::dsync : open_flags(0));
 
-    descriptor d(next_id(), cfg.fname_prefix);
+    descriptor d(next_id(), cfg.fname_prefix, cfg.use_compression ? descriptor::compressed_version : descriptor::default_version);
     file_open_options opt;
     opt.extent_allocation_size_hint = max_size;
     auto filename = cfg.commit_log_location + "/" + d.filename();
-    auto fut = do_io_check(commit_error_handler, [&] {
+
+    // A recycled file is already zeroed up to max_size, a new one needs to be
+    // zeroed if we want to reuse it, so that even its first use doesn't
+    // allocate blocks on the write path.
+    auto reused = !_recycled_segments.empty();
+    auto zero_fill = !reused && reuse_segments();
+    auto prepared = make_ready_future<>();
+    if (reused) {
+        auto recycled = std::move(_recycled_segments.back());
+        _recycled_segments.pop_back();
+        clogger.debug("Reusing segment file {} as {}", recycled, filename);
+        prepared = commit_io_check(&seastar::rename_file, recycled, filename).then([this] {
+            return commit_io_check(&seastar::sync_directory, cfg.commit_log_location);
+        }).then([this] {
+            ++totals.segments_reused;
+        });
+    }
+
+    auto fut = prepared.then([this, flags, opt, filename] {
+      return do_io_check(commit_error_handler, [&] {
         auto fut = open_file_dma(filename, flags, opt);
         if (cfg.extensions && !cfg.extensions->commitlog_file_extensions().empty()) {
-            fut = fut.then([this, filename](file f) {
-                return do_with(std::move(f), [this, filename](file& f) {
+            fut = fut.then([this, filename, flags](file f) {
+                return do_with(std::move(f), [this, filename, flags](file& f) {
                     auto ext_range = cfg.extensions->commitlog_file_extensions();
                     return do_for_each(ext_range.begin(), ext_range.end(), [&f, filename](auto& ext) {
                         // note: we're potentially wrapping more than once. extension mechanism
@@ -1215,18 +1470,65 @@ future<db::commitlog::segment_manager::sseg_ptr> db::commitlog::segment_manager:
             });
         }
         return fut;
+      });
     });
 
-    return fut.then([this, d, active, filename](file f) {
+    return fut.then([this, d, active, filename, zero_fill](file f) {
         f = make_checked_file(commit_error_handler, f);
         // xfs doesn't like files extended betond eof, so enlarge the file
-        return f.truncate(max_size).then([this, d, active, f, filename] () mutable {
+        return f.truncate(max_size).then([this, f, zero_fill] () mutable {
+            return zero_fill ? zero_fill_segment(f) : make_ready_future<>();
+        }).then([this, d, active, f, filename] () mutable {
             auto s = make_shared<segment>(this->shared_from_this(), d, std::move(f), active);
             return make_ready_future<sseg_ptr>(s);
         });
     });
 }
 
+// Writes zeros over the whole segment file and syncs it. Later writes to the
+// file then don't allocate blocks or convert unwritten extents, so they need
+// no file system metadata updates, and replay sees the file as empty.
+future<> db::commitlog::segment_manager::zero_fill_segment(file f) {
+    static constexpr size_t zero_buffer_size = 1024 * 1024;
+    auto buf = allocate_aligned_buffer<char>(zero_buffer_size, segment::alignment);
+    std::fill_n(buf.get(), zero_buffer_size, 0);
+    return do_with(std::move(buf), uint64_t(0), [this, f] (auto& buf, uint64_t& pos) mutable {
+        return do_until([this, &pos] { return pos >= max_size; }, [this, f, &buf, &pos] () mutable {
+            auto len = std::min<uint64_t>(zero_buffer_size, max_size - pos);
+            return f.dma_write(pos, buf.get(), len, service::get_local_commitlog_priority()).then([&pos] (size_t bytes) {
+                if (!bytes) {
+                    throw std::runtime_error("Short write while zeroing commitlog segment");
+                }
+                pos += bytes;
+            });
+        }).then([f] () mutable {
+            return f.flush();
+        });
+    });
+}
+
+future<> db::commitlog::segment_manager::recycle_segments(std::vector<sstring> files) {
+    _segments_being_recycled += files.size();
+    return parallel_for_each(files, [this](auto& filename) {
+        return do_io_check(commit_error_handler, [&] {
+            return open_file_dma(filename, open_flags::wo);
+        }).then([this] (file f) {
+            return zero_fill_segment(f).finally([f] () mutable {
+                return f.close();
+            });
+        }).then([this, &filename] {
+            clogger.debug("Recycled segment file {}", filename);
+            ++totals.segments_recycled;
+            _recycled_segments.push_back(filename);
+        }).handle_exception([this, &filename] (auto ep) {
+            clogger.warn("Could not recycle segment {}, deleting it: {}", filename, ep);
+            return this->delete_segments({ filename });
+        });
+    }).finally([this, files = std::move(files)] {
+        _segments_being_recycled -= files.size();
+    });
+}
+
 future<db::commitlog::segment_manager::sseg_ptr> db::commitlog::segment_manager::new_segment() {
     if (_shutdown) {
         throw std::runtime_error("Commitlog has been shut down. Cannot add data");
@@ -1350,7 +1652,9 @@ future<> db::commitlog::segment_manager::clear_reserve_segments() {
     while (!_reserve_segments.empty()) {
         _reserve_segments.pop();
     }
-    return do_pending_deletes();
+    return do_pending_deletes().then([this] {
+        return delete_segments(std::exchange(_recycled_segments, {}));
+    });
 }
 
 future<> db::commitlog::segment_manager::sync_all_segments(bool shutdown) {
@@ -1432,7 +1736,15 @@ future<> db::commitlog::segment_manager::do_pending_deletes() {
     return parallel_for_each(i, e, [](file & f) {
         return f.close();
     }).then([this, ftc = std::move(ftc)] {
-        return delete_segments(boost::copy_range<std::vector<sstring>>(std::exchange(_files_to_delete, {}) | boost::adaptors::map_keys));
+        auto files = boost::copy_range<std::vector<sstring>>(std::exchange(_files_to_delete, {}) | boost::adaptors::map_keys);
+        std::vector<sstring> to_recycle;
+        if (reuse_segments() && !_shutdown) {
+            auto pooled = _recycled_segments.size() + _segments_being_recycled;
+            auto n = std::min<size_t>(files.size(), cfg.max_reserve_segments - std::min<size_t>(pooled, cfg.max_reserve_segments));
+            std::move(files.end() - n, files.end(), std::back_inserter(to_recycle));
+            files.resize(files.size() - n);
+        }
+        return when_all(recycle_segments(std::move(to_recycle)), delete_segments(std::move(files))).discard_result();
     });
 }
 
@@ -1470,7 +1782,7 @@ void db::commitlog::segment_manager::on_timer() {
     // without waiting for them, so segement_manager could be shut down
     // while they are running.
     seastar::with_gate(_gate, [this] {
-        if (cfg.mode != sync_mode::BATCH) {
+        if (cfg.mode == sync_mode::PERIODIC) {
             sync();
         }
         // IFF a new segment was put in use since last we checked, and we're
@@ -1651,7 +1963,8 @@ future<> db::commitlog::release() {
 }
 
 size_t db::commitlog::max_record_size() const {
-    return _segment_manager->max_mutation_size - segment::entry_overhead_size;
+    auto payload_overhead = _segment_manager->cfg.use_compression ? sizeof(uint32_t) : 0;
+    return _segment_manager->max_mutation_size - segment::entry_overhead_size - payload_overhead;
 }
 
 uint64_t db::commitlog::max_active_writes() const {
@@ -1670,6 +1983,24 @@ const db::commitlog::config& db::commitlog::active_config() const {
     return _segment_manager->cfg;
 }
 
+// Reverses segment::compress_entry().
+static temporary_buffer<char> uncompress_entry(temporary_buffer<char> payload) {
+    if (payload.size() < sizeof(uint32_t)) {
+        throw std::runtime_error("Compressed entry too short");
+    }
+    auto size = read_be<uint32_t>(payload.get());
+    payload.trim_front(sizeof(uint32_t));
+    if (payload.size() == size) {
+        return payload;
+    }
+    temporary_buffer<char> data(size);
+    auto ret = LZ4_decompress_safe(payload.get(), data.get_write(), payload.size(), size);
+    if (ret < 0 || size_t(ret) != size) {
+        throw std::runtime_error("LZ4 uncompression failure");
+    }
+    return data;
+}
+
 // No commit_io_check needed in the log reader since the database will fail
 // on error at startup if required
 future<std::unique_ptr<subscription<temporary_buffer<char>, db::replay_position>>>
@@ -1698,6 +2029,7 @@ db::commitlog::read_log_file(const sstring& filename, seastar::io_priority_class
         bool eof = false;
         bool header = true;
         bool failed = false;
+        bool compressed = false;
 
         work(file f, seastar::io_priority_class read_io_prio_class, position_type o = 0)
                 : f(f), fin(make_file_input_stream(f, 0, make_file_input_stream_options(read_io_prio_class))), start_off(o) {
@@ -1769,6 +2101,7 @@ db::commitlog::read_log_file(const sstring& filename, seastar::io_priority_class
 
                 this->id = id;
                 this->next = 0;
+                this->compressed = descriptor(id, "", ver).compressed();
 
                 return make_ready_future<>();
             });
@@ -1871,7 +2204,18 @@ db::commitlog::read_log_file(const sstring& filename, seastar::io_priority_class
                         return make_ready_future<>();
                     }
 
-                    return s.produce(buf.share(0, data_size), rp).handle_exception([this](auto ep) {
+                    auto data = buf.share(0, data_size);
+                    if (compressed) {
+                        try {
+                            data = uncompress_entry(std::move(data));
+                        } catch (...) {
+                            clogger.debug("Segment entry at {} failed to uncompress: {}. Skipping {} bytes", rp, std::current_exception(), size);
+                            corrupt_size += size;
+                            return make_ready_future<>();
+                        }
+                    }
+
+                    return s.produce(std::move(data), rp).handle_exception([this](auto ep) {
                         return this->fail();
                     });
                 });
@@ -1975,6 +2319,14 @@ uint64_t db::commitlog::get_num_segments_destroyed() const {
     return _segment_manager->totals.segments_destroyed;
 }
 
+uint64_t db::commitlog::get_num_segments_recycled() const {
+    return _segment_manager->totals.segments_recycled;
+}
+
+uint64_t db::commitlog::get_num_segments_reused() const {
+    return _segment_manager->totals.segments_reused;
+}
+
 uint64_t db::commitlog::get_num_dirty_segments() const {
     return _segment_manager->get_num_dirty_segments();
 }
@@ -78,6 +78,11 @@ class extensions;
  * In BATCH mode, every write to the log will also send the data to disk
  * + issue a flush and wait for both to complete.
  *
+ * In GROUP mode, writes are not acknowledged until they are on disk either,
+ * but all writes arriving within a short window share a single write and
+ * flush. The window is bounded by commitlog_sync_group_window_in_us, and
+ * adapted to the observed flush latency and write arrival rate.
+ *
  * In PERIODIC mode, most writes will only add to the internal memory
  * buffers. If the mem buffer is saturated, data is sent to disk, but we
  * don't wait for the write to complete. However, if periodic (timer)
@@ -105,7 +110,7 @@ class commitlog {
     ::shared_ptr<segment_manager> _segment_manager;
 public:
     enum class sync_mode {
-        PERIODIC, BATCH
+        PERIODIC, BATCH, GROUP
     };
     struct config {
         config() = default;
@@ -117,6 +122,8 @@ class commitlog {
         uint64_t commitlog_total_space_in_mb = 0;
         uint64_t commitlog_segment_size_in_mb = 32;
         uint64_t commitlog_sync_period_in_ms = 10 * 1000; //TODO: verify default!
+        // Upper bound on how long a write waits for others to share a sync with in GROUP mode.
+        uint64_t commitlog_sync_group_window_in_us = 2000;
         // Max number of segments to keep in pre-alloc reserve.
         // Not (yet) configurable from scylla.conf.
         uint64_t max_reserve_segments = 12;
@@ -126,6 +133,14 @@ class commitlog {
         uint64_t max_active_flushes = 0;
 
         sync_mode mode = sync_mode::PERIODIC;
+        // Keep the files of discarded segments, zeroed, for reuse by new
+        // segments, instead of deleting them and creating new ones.
+        bool reuse_segments = false;
+        // Open segments with O_DSYNC, making each write durable on its own,
+        // instead of issuing an fdatasync to flush them.
+        bool use_o_dsync = false;
+        // Compress entries with LZ4 before writing them.
+        bool use_compression = false;
         std::string fname_prefix = descriptor::FILENAME_PREFIX;
 
         const db::extensions * extensions = nullptr;
@@ -141,10 +156,19 @@ class commitlog {
 
         descriptor(descriptor&&) = default;
         descriptor(const descriptor&) = default;
-        descriptor(segment_id_type i, const std::string& fname_prefix, uint32_t v = 1);
+        descriptor(segment_id_type i, const std::string& fname_prefix, uint32_t v = default_version);
         descriptor(replay_position p, const std::string& fname_prefix = FILENAME_PREFIX);
         descriptor(const sstring& filename, const std::string& fname_prefix = FILENAME_PREFIX);
 
+        // Segment format versions. The entries of a compressed segment are
+        // LZ4-compressed, each on its own.
+        static constexpr uint32_t default_version = 1;
+        static constexpr uint32_t compressed_version = 2;
+
+        bool compressed() const {
+            return ver == compressed_version;
+        }
+
         sstring filename() const;
         operator replay_position() const;
 
@@ -288,6 +312,8 @@ class commitlog {
     uint64_t get_flush_limit_exceeded_count() const;
     uint64_t get_num_segments_created() const;
     uint64_t get_num_segments_destroyed() const;
+    uint64_t get_num_segments_recycled() const;
+    uint64_t get_num_segments_reused() const;
     /**
      * Get number of inactive (finished), segments lingering
      * due to still being dirty
@@ -43,10 +43,13 @@
 #include <vector>
 #include <algorithm>
 #include <unordered_map>
+#include <chrono>
 #include <boost/range/adaptor/map.hpp>
+#include <boost/range/irange.hpp>
 
 #include <seastar/core/future.hh>
 #include <seastar/core/sharded.hh>
+#include <seastar/core/semaphore.hh>
 
 #include "commitlog.hh"
 #include "commitlog_replayer.hh"
@@ -81,25 +84,7 @@ class db::commitlog_replayer::impl {
 
     future<> init();
 
-    struct stats {
-        uint64_t invalid_mutations = 0;
-        uint64_t skipped_mutations = 0;
-        uint64_t applied_mutations = 0;
-        uint64_t corrupt_bytes = 0;
-
-        stats& operator+=(const stats& s) {
-            invalid_mutations += s.invalid_mutations;
-            skipped_mutations += s.skipped_mutations;
-            applied_mutations += s.applied_mutations;
-            corrupt_bytes += s.corrupt_bytes;
-            return *this;
-        }
-        stats operator+(const stats& s) const {
-            stats tmp = *this;
-            tmp += s;
-            return tmp;
-        }
-    };
+    using stats = commitlog_replayer::stats;
 
     // move start/stop of the thread local bookkeep to "top level"
     // and also make sure to assert on it actually being started.
@@ -110,9 +95,35 @@ class db::commitlog_replayer::impl {
         return _column_mappings.stop();
     }
 
-    future<> process(stats*, temporary_buffer<char> buf, replay_position rp) const;
+    // A mutation read from a segment, on its way to the shard owning it.
+    struct replay_entry {
+        commitlog_entry_reader cer;
+        // Belongs to the reading shard's _column_mappings.
+        const column_mapping* cm;
+        replay_position rp;
+    };
+    using replay_batch = std::vector<replay_entry>;
+
+    struct batch_result {
+        uint64_t applied_mutations = 0;
+        uint64_t invalid_mutations = 0;
+    };
+
+    class batcher;
+
+    // Segments replayed concurrently by each shard.
+    static constexpr unsigned max_concurrent_segments = 4;
+    // A batch is sent to its owning shard once it reaches either limit.
+    static constexpr size_t max_batch_entries = 128;
+    static constexpr size_t max_batch_bytes = 1024 * 1024;
+
+    future<> process(batcher*, temporary_buffer<char> buf, replay_position rp) const;
     future<stats> recover(sstring file, const sstring& fname_prefix) const;
 
+    // Applies a batch of mutations owned by this shard straight into the memtables.
+    future<batch_result> apply_batch(replay_batch batch) const;
+    void apply_entry(database& db, const replay_entry& e) const;
+
     typedef std::unordered_map<utils::UUID, replay_position> rp_map;
     typedef std::unordered_map<unsigned, rp_map> shard_rpm_map;
     typedef std::unordered_map<unsigned, replay_position> shard_rp_map;
@@ -136,12 +147,83 @@ class db::commitlog_replayer::impl {
         _rpm;
     shard_rp_map
         _min_pos;
+    stats
+        _totals;
 };
 
 db::commitlog_replayer::impl::impl(seastar::sharded<cql3::query_processor>& qp)
     : _qp(qp)
 {}
 
+// Groups the mutations read from a segment by owning shard, so that they
+// cross shards in batches rather than one by one. Each owning shard has at
+// most one batch in flight while the next one is being filled.
+class db::commitlog_replayer::impl::batcher {
+    const impl& _impl;
+    stats _stats;
+    std::vector<replay_batch> _batches;
+    std::vector<size_t> _batch_bytes;
+    std::vector<future<>> _in_flight;
+public:
+    explicit batcher(const impl& i)
+        : _impl(i)
+        , _batches(smp::count)
+        , _batch_bytes(smp::count)
+    {
+        _in_flight.reserve(smp::count);
+        for (unsigned i = 0; i < smp::count; ++i) {
+            _in_flight.push_back(make_ready_future<>());
+        }
+    }
+
+    stats& get_stats() {
+        return _stats;
+    }
+
+    future<> add(unsigned shard, replay_entry e, size_t size) {
+        _batches[shard].push_back(std::move(e));
+        _batch_bytes[shard] += size;
+        if (_batches[shard].size() < max_batch_entries && _batch_bytes[shard] < max_batch_bytes) {
+            return make_ready_future<>();
+        }
+        return flush(shard);
+    }
+
+    // Sends the batch for the given shard once the previous one was applied.
+    future<> flush(unsigned shard) {
+        if (_batches[shard].empty()) {
+            return make_ready_future<>();
+        }
+        auto batch = std::exchange(_batches[shard], replay_batch());
+        _batch_bytes[shard] = 0;
+        auto prev = std::exchange(_in_flight[shard], make_ready_future<>());
+        return prev.then([this, shard, batch = std::move(batch)] () mutable {
+            auto size = batch.size();
+            _in_flight[shard] = smp::submit_to(shard, [&impl = _impl, batch = std::move(batch)] () mutable {
+                return impl.apply_batch(std::move(batch));
+            }).then_wrapped([this, size] (future<batch_result> f) {
+                try {
+                    auto r = f.get0();
+                    _stats.applied_mutations += r.applied_mutations;
+                    _stats.invalid_mutations += r.invalid_mutations;
+                } catch (...) {
+                    _stats.invalid_mutations += size;
+                    rlogger.warn("error replaying: {}", std::current_exception());
+                }
+            });
+        });
+    }
+
+    // Sends all pending batches and waits for every one of them to be applied. Never fails.
+    future<> flush_all() {
+        return parallel_for_each(boost::irange(0u, smp::count), [this] (unsigned shard) {
+            return flush(shard).then([this, shard] {
+                return std::exchange(_in_flight[shard], make_ready_future<>());
+            });
+        });
+    }
+};
+
 future<> db::commitlog_replayer::impl::init() {
     return _qp.map_reduce([this](shard_rpm_map map) {
         for (auto& p1 : map) {
@@ -221,27 +303,33 @@ db::commitlog_replayer::impl::recover(sstring file, const sstring& fname_prefix)
         p = gp.pos;
     }
 
-    auto s = make_lw_shared<stats>();
+    auto b = make_lw_shared<batcher>(*this);
     auto& exts = _qp.local().db().local().get_config().extensions();
 
     return db::commitlog::read_log_file(file, service::get_local_commitlog_priority(),
-            std::bind(&impl::process, this, s.get(), std::placeholders::_1,
+            std::bind(&impl::process, this, b.get(), std::placeholders::_1,
                     std::placeholders::_2), p, &exts).then([](auto s) {
         auto f = s->done();
         return f.finally([s = std::move(s)] {});
-    }).then_wrapped([s](future<> f) {
-        try {
-            f.get();
-        } catch (commitlog::segment_data_corruption_error& e) {
-            s->corrupt_bytes += e.bytes();
-        } catch (...) {
-            throw;
-        }
-        return make_ready_future<stats>(*s);
+    }).then_wrapped([b](future<> f) {
+        // Whatever happened to the read, the mutations already batched must be
+        // applied before the batcher goes away.
+        return b->flush_all().then([b, f = std::move(f)] () mutable {
+            try {
+                f.get();
+            } catch (commitlog::segment_data_corruption_error& e) {
+                b->get_stats().corrupt_bytes += e.bytes();
+            } catch (...) {
+                throw;
+            }
+            return make_ready_future<stats>(b->get_stats());
+        });
     });
 }
 
-future<> db::commitlog_replayer::impl::process(stats* s, temporary_buffer<char> buf, replay_position rp) const {
+future<> db::commitlog_replayer::impl::process(batcher* b, temporary_buffer<char> buf, replay_position rp) const {
+    auto& s = b->get_stats();
+    s.replayed_bytes += buf.size();
     try {
 
         commitlog_entry_reader cer(buf);
@@ -261,7 +349,7 @@ future<> db::commitlog_replayer::impl::process(stats* s, temporary_buffer<char>
         auto shard_id = rp.shard_id();
         if (rp < min_pos(shard_id)) {
             rlogger.trace("entry {} is less than global min position. skipping", rp);
-            s->skipped_mutations++;
+            s.skipped_mutations++;
             return make_ready_future<>();
         }
 
@@ -269,52 +357,16 @@ future<> db::commitlog_replayer::impl::process(stats* s, temporary_buffer<char>
         auto cf_rp = cf_min_pos(uuid, shard_id);
         if (rp <= cf_rp) {
             rlogger.trace("entry {} at {} is younger than recorded replay position {}. skipping", fm.column_family_id(), rp, cf_rp);
-            s->skipped_mutations++;
+            s.skipped_mutations++;
             return make_ready_future<>();
         }
 
         auto shard = _qp.local().db().local().shard_of(fm);
-        return _qp.local().db().invoke_on(shard, [this, cer = std::move(cer), &src_cm, rp, shard, s] (database& db) -> future<> {
-            auto& fm = cer.mutation();
-            // TODO: might need better verification that the deserialized mutation
-            // is schema compatible. My guess is that just applying the mutation
-            // will not do this.
-            auto& cf = db.find_column_family(fm.column_family_id());
-
-            if (rlogger.is_enabled(logging::log_level::debug)) {
-                rlogger.debug("replaying at {} v={} {}:{} at {}", fm.column_family_id(), fm.schema_version(),
-                        cf.schema()->ks_name(), cf.schema()->cf_name(), rp);
-            }
-            // Removed forwarding "new" RP. Instead give none/empty.
-            // This is what origin does, and it should be fine.
-            // The end result should be that once sstables are flushed out
-            // their "replay_position" attribute will be empty, which is
-            // lower than anything the new session will produce.
-            if (cf.schema()->version() != fm.schema_version()) {
-                auto& local_cm = _column_mappings.local().map;
-                auto cm_it = local_cm.find(fm.schema_version());
-                if (cm_it == local_cm.end()) {
-                    cm_it = local_cm.emplace(fm.schema_version(), src_cm).first;
-                }
-                const column_mapping& cm = cm_it->second;
-                mutation m(cf.schema(), fm.decorated_key(*cf.schema()));
-                converting_mutation_partition_applier v(cm, *cf.schema(), m.partition());
-                fm.partition().accept(cm, v);
-                cf.apply(std::move(m));
-            } else {
-                cf.apply(fm, cf.schema());
-            }
-            s->applied_mutations++;
-            return make_ready_future<>();
-        }).handle_exception([s](auto ep) {
-            s->invalid_mutations++;
-            // TODO: write mutation to file like origin.
-            rlogger.warn("error replaying: {}", ep);
-        });
+        return b->add(shard, replay_entry{std::move(cer), &src_cm, rp}, buf.size());
     } catch (no_such_column_family&) {
         // No such CF now? Origin just ignores this.
     } catch (...) {
-        s->invalid_mutations++;
+        s.invalid_mutations++;
         // TODO: write mutation to file like origin.
         rlogger.warn("error replaying: {}", std::current_exception());
     }
@@ -322,6 +374,65 @@ future<> db::commitlog_replayer::impl::process(stats* s, temporary_buffer<char>
     return make_ready_future<>();
 }
 
+future<db::commitlog_replayer::impl::batch_result> db::commitlog_replayer::impl::apply_batch(replay_batch batch) const {
+    return do_with(std::move(batch), batch_result(), [this] (replay_batch& batch, batch_result& res) {
+        auto& db = _qp.local().db().local();
+        return do_for_each(batch, [this, &db, &res] (const replay_entry& e) {
+            return futurize_apply([this, &db, &e] {
+                auto& cf = db.find_column_family(e.cer.mutation().column_family_id());
+                // Wait for dirty memory like regular writes do, so that replay
+                // keeps going while full memtables are flushed in the background.
+                return cf.dirty_memory_region_group().run_when_memory_available([this, &db, &e] {
+                    apply_entry(db, e);
+                });
+            }).then_wrapped([&res] (future<> f) {
+                try {
+                    f.get();
+                    res.applied_mutations++;
+                } catch (...) {
+                    res.invalid_mutations++;
+                    // TODO: write mutation to file like origin.
+                    rlogger.warn("error replaying: {}", std::current_exception());
+                }
+            });
+        }).then([&res] {
+            return res;
+        });
+    });
+}
+
+void db::commitlog_replayer::impl::apply_entry(database& db, const replay_entry& e) const {
+    auto& fm = e.cer.mutation();
+    // TODO: might need better verification that the deserialized mutation
+    // is schema compatible. My guess is that just applying the mutation
+    // will not do this.
+    auto& cf = db.find_column_family(fm.column_family_id());
+
+    if (rlogger.is_enabled(logging::log_level::debug)) {
+        rlogger.debug("replaying at {} v={} {}:{} at {}", fm.column_family_id(), fm.schema_version(),
+                cf.schema()->ks_name(), cf.schema()->cf_name(), e.rp);
+    }
+    // Removed forwarding "new" RP. Instead give none/empty.
+    // This is what origin does, and it should be fine.
+    // The end result should be that once sstables are flushed out
+    // their "replay_position" attribute will be empty, which is
+    // lower than anything the new session will produce.
+    if (cf.schema()->version() != fm.schema_version()) {
+        auto& local_cm = _column_mappings.local().map;
+        auto cm_it = local_cm.find(fm.schema_version());
+        if (cm_it == local_cm.end()) {
+            cm_it = local_cm.emplace(fm.schema_version(), *e.cm).first;
+        }
+        const column_mapping& cm = cm_it->second;
+        mutation m(cf.schema(), fm.decorated_key(*cf.schema()));
+        converting_mutation_partition_applier v(cm, *cf.schema(), m.partition());
+        fm.partition().accept(cm, v);
+        cf.apply(std::move(m));
+    } else {
+        cf.apply(fm, cf.schema());
+    }
+}
+
 db::commitlog_replayer::commitlog_replayer(seastar::sharded<cql3::query_processor>& qp)
     : _impl(std::make_unique<impl>(qp))
 {}
@@ -360,30 +471,48 @@ future<> db::commitlog_replayer::recover(std::vector<sstring> files, sstring fna
             return map_reduce(smp::all_cpus(), [this, map, &fname_prefix] (unsigned id) {
                 return smp::submit_to(id, [this, id, map, &fname_prefix] () {
                     auto total = ::make_lw_shared<impl::stats>();
-                    // TODO: or something. For now, we do this serialized per shard,
-                    // to reduce mutation congestion. We could probably (says avi)
-                    // do 2 segments in parallel or something, but lets use this first.
                     auto range = map->equal_range(id);
-                    return do_for_each(range.first, range.second, [this, total, &fname_prefix] (const std::pair<unsigned, sstring>& p) {
-                        auto&f = p.second;
-                        rlogger.debug("Replaying {}", f);
-                        return _impl->recover(f, fname_prefix).then([f, total](impl::stats stats) {
-                            if (stats.corrupt_bytes != 0) {
-                                rlogger.warn("Corrupted file: {}. {} bytes skipped.", f, stats.corrupt_bytes);
-                            }
-                            rlogger.debug("Log replay of {} complete, {} replayed mutations ({} invalid, {} skipped)"
-                                            , f
-                                            , stats.applied_mutations
-                                            , stats.invalid_mutations
-                                            , stats.skipped_mutations
-                            );
-                            *total += stats;
+                    auto segments = std::distance(range.first, range.second);
+                    auto start = std::chrono::steady_clock::now();
+                    // Mutations are commutative, so segments can be replayed in any
+                    // order. Replay a few at a time to keep the disk busy while
+                    // earlier batches are being applied.
+                    auto sem = ::make_lw_shared<semaphore>(impl::max_concurrent_segments);
+                    return parallel_for_each(range.first, range.second, [this, total, sem, &fname_prefix] (const std::pair<unsigned, sstring>& p) {
+                        return with_semaphore(*sem, 1, [this, total, &p, &fname_prefix] {
+                            auto&f = p.second;
+                            rlogger.debug("Replaying {}", f);
+                            return _impl->recover(f, fname_prefix).then([f, total](impl::stats stats) {
+                                if (stats.corrupt_bytes != 0) {
+                                    rlogger.warn("Corrupted file: {}. {} bytes skipped.", f, stats.corrupt_bytes);
+                                }
+                                rlogger.debug("Log replay of {} complete, {} replayed mutations ({} invalid, {} skipped)"
+                                                , f
+                                                , stats.applied_mutations
+                                                , stats.invalid_mutations
+                                                , stats.skipped_mutations
+                                );
+                                *total += stats;
+                            });
                         });
-                    }).then([total] {
+                    }).then([total, segments, start] {
+                        if (segments) {
+                            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                            auto rate = [elapsed] (double n) { return elapsed > 0 ? n / elapsed : 0; };
+                            rlogger.info("Replayed {} segments on this shard in {:.3f}s: {} bytes ({:.1f} MB/s), {} mutations ({:.0f}/s)"
+                                            , segments
+                                            , elapsed
+                                            , total->replayed_bytes
+                                            , rate(total->replayed_bytes) / (1024 * 1024)
+                                            , total->applied_mutations
+                                            , rate(total->applied_mutations)
+                            );
+                        }
                         return make_ready_future<impl::stats>(*total);
                     });
                 });
-            }, impl::stats(), std::plus<impl::stats>()).then([](impl::stats totals) {
+            }, impl::stats(), std::plus<impl::stats>()).then([this](impl::stats totals) {
+                _impl->_totals = totals;
                 rlogger.info("Log replay complete, {} replayed mutations ({} invalid, {} skipped)"
                                 , totals.applied_mutations
                                 , totals.invalid_mutations
@@ -400,3 +529,7 @@ future<> db::commitlog_replayer::recover(sstring f, sstring fname_prefix) {
     return recover(std::vector<sstring>{ f }, std::move(fname_prefix));
 }
 
+const db::commitlog_replayer::stats& db::commitlog_replayer::get_stats() const {
+    return _impl->_totals;
+}
+
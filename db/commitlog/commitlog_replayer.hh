@@ -57,6 +57,28 @@ class commitlog;
 
 class commitlog_replayer {
 public:
+    struct stats {
+        uint64_t invalid_mutations = 0;
+        uint64_t skipped_mutations = 0;
+        uint64_t applied_mutations = 0;
+        uint64_t corrupt_bytes = 0;
+        uint64_t replayed_bytes = 0;
+
+        stats& operator+=(const stats& s) {
+            invalid_mutations += s.invalid_mutations;
+            skipped_mutations += s.skipped_mutations;
+            applied_mutations += s.applied_mutations;
+            corrupt_bytes += s.corrupt_bytes;
+            replayed_bytes += s.replayed_bytes;
+            return *this;
+        }
+        stats operator+(const stats& s) const {
+            stats tmp = *this;
+            tmp += s;
+            return tmp;
+        }
+    };
+
     commitlog_replayer(commitlog_replayer&&) noexcept;
     ~commitlog_replayer();
 
@@ -65,6 +87,9 @@ class commitlog_replayer {
     future<> recover(std::vector<sstring> files, sstring fname_prefix);
     future<> recover(sstring file, sstring fname_prefix);
 
+    // Totals of the last recover(), summed over all shards.
+    const stats& get_stats() const;
+
 private:
     commitlog_replayer(seastar::sharded<cql3::query_processor>&);
 
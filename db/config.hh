@@ -155,7 +155,7 @@ class config : public utils::config_file {
     val(hints_directory, sstring, "/var/lib/scylla/hints", Used,   \
             "The directory where hints files are stored if hinted handoff is enabled."   \
     )                                           \
-    val(saved_caches_directory, sstring, "/var/lib/scylla/saved_caches", Unused, \
+    val(saved_caches_directory, sstring, "/var/lib/scylla/saved_caches", Used, \
             "The directory location where table key and row caches are stored."  \
     )                                                   \
     /* Commonly used properties */  \
@@ -261,6 +261,7 @@ class config : public utils::config_file {
             "\n"    \
             "\tperiodic : Used with commitlog_sync_period_in_ms (Default: 10000 - 10 seconds ) to control how often the commit log is synchronized to disk. Periodic syncs are acknowledged immediately.\n"   \
             "\tbatch : Used with commitlog_sync_batch_window_in_ms (Default: disabled **) to control how long Scylla waits for other writes before performing a sync. When using this method, writes are not acknowledged until fsynced to disk.\n"  \
+            "\tgroup : Used with commitlog_sync_group_window_in_us to control how long Scylla may wait for other writes before performing a sync shared by all of them. Writes are not acknowledged until fsynced to disk. The actual wait adapts to the observed sync latency and write rate, and is zero when no other writes are expected.\n"  \
             "Related information: Durability"   \
     )                                                   \
     val(commitlog_segment_size_in_mb, uint32_t, 64, Used,     \
@@ -275,6 +276,18 @@ class config : public utils::config_file {
     val(commitlog_sync_batch_window_in_ms, uint32_t, 10000, Used,     \
             "Controls how long the system waits for other writes before performing a sync in \"batch\" mode."    \
     )   \
+    val(commitlog_sync_group_window_in_us, uint32_t, 2000, Used,     \
+            "The maximum time, in microseconds, a write waits for other writes to share a sync with in \"group\" mode."    \
+    )   \
+    val(commitlog_reuse_segments, bool, false, Used,     \
+            "Keep the files of discarded commitlog segments, pre-zeroed, and reuse them for new segments instead of creating and deleting files. This avoids file system metadata updates on the write path, which otherwise show up as latency spikes."    \
+    )   \
+    val(commitlog_use_o_dsync, bool, false, Used,     \
+            "Open commitlog segments with O_DSYNC, so that each write is durable when it completes, and no separate fdatasync is needed. Works best with commitlog_reuse_segments, which makes sure writes don't need to allocate blocks."    \
+    )   \
+    val(commitlog_compression, bool, false, Used,     \
+            "Compress commitlog entries with LZ4. Reduces commitlog disk bandwidth for compressible data, such as large text values, at the cost of some CPU on the write path. Segments written with compression cannot be replayed by versions which don't support it."    \
+    )   \
     val(commitlog_total_space_in_mb, int64_t, -1, Used,     \
             "Total space used for commitlogs. If the used space goes above this value, Scylla rounds up to the next nearest segment multiple and flushes memtables to disk for the oldest commitlog segments, removing those log segments. This reduces the amount of data to replay on startup, and prevents infrequently-updated tables from indefinitely keeping commitlog segments. A small total commitlog space tends to cause more flush activity on less-active tables.\n"  \
             "Related information: Configuring memtable throughput"  \
@@ -314,8 +327,8 @@ class config : public utils::config_file {
             "The number of full memtables to allow pending flush (memtables waiting for a write thread). At a minimum, set to the maximum number of indexes created on a single table.\n"  \
             "Related information: Flushing data from the memtable"  \
     )   \
-    val(memtable_flush_writers, uint32_t, 1, Invalid,     \
-            "Sets the number of memtable flush writer threads. These threads are blocked by disk I/O, and each one holds a memtable in memory while blocked. If you have a large Java heap size and many data directories, you can increase the value for better flush performance."  \
+    val(memtable_flush_writers, uint32_t, 1, Used,     \
+            "Sets the number of sstable writers a single memtable flush is split into. Each writer handles a separate token range of the memtable, and together they produce a run of disjoint sstables. Increasing this value allows flushes to keep up with bursts of writes when flushing is bound by CPU rather than by disk. Small memtables are always flushed into a single sstable."  \
     )   \
     val(memtable_heap_space_in_mb, uint32_t, 0, Unused,     \
             "Total permitted memory to use for memtables. Triggers a flush based on memtable_cleanup_threshold. Cassandra stops accepting writes when the limit is exceeded until a flush completes. If unset, sets to default."  \
@@ -415,14 +428,17 @@ class config : public utils::config_file {
             "A global cache setting for tables. It is the maximum size of the key cache in memory. To disable set to 0.\n"  \
             "Related information: nodetool setcachecapacity."   \
     )   \
-    val(row_cache_keys_to_save, uint32_t, 0, Unused,                \
-            "Number of keys from the row cache to save."  \
+    val(row_cache_keys_to_save, uint32_t, 0, Used,                \
+            "Number of the hottest partition keys from the row cache to save, per shard. The saved keys are used to warm up the cache after a restart. Only partitions of the few thousand most recently used rows are considered. Set to 0 to disable saving and warm-up."  \
     )   \
     val(row_cache_size_in_mb, uint32_t, 0, Unused,                \
             "Maximum size of the row cache in memory. Row cache can save more time than key_cache_size_in_mb, but is space-intensive because it contains the entire row. Use the row cache only for hot rows or static rows. If you reduce the size, you may not get you hottest keys loaded on start up."  \
     )   \
-    val(row_cache_save_period, uint32_t, 0, Unused,     \
-            "Duration in seconds that rows are saved in cache. Caches are saved to saved_caches_directory."  \
+    val(row_cache_save_period, uint32_t, 0, Used,     \
+            "Duration in seconds after which the keys of the hottest partitions in the row cache are saved. Caches are saved to saved_caches_directory. Set to 0 to disable saving."  \
+    )   \
+    val(row_cache_warmup_bandwidth_mb_per_sec, uint32_t, 16, Used,     \
+            "Throttles the rate at which partitions saved by row_cache_save_period are read back into the row cache after a restart, per shard. Set to 0 to disable throttling."  \
     )   \
     val(memory_allocator, sstring, "NativeAllocator", Invalid,     \
             "The off-heap memory allocator. In addition to caches, this property affects storage engine meta data. Supported values:\n"  \
@@ -504,6 +520,9 @@ class config : public utils::config_file {
     val(inter_dc_tcp_nodelay, bool, false, Used,     \
             "Enable or disable tcp_nodelay for inter-data center communication. When disabled larger, but fewer, network packets are sent. This reduces overhead from the TCP protocol itself. However, if cross data-center responses are blocked, it will increase latency."  \
     )   \
+    val(internode_shard_aware_connections, bool, false, Used,     \
+            "Send reads and writes to the shard of the replica that owns the data, over connections that the replica accepts on that shard, so that it doesn't need to move the request to another shard. Each shard then opens up to one connection per shard of every other node, so the number of connections grows with the square of the shard count. Relies on the source ports of internode connections not being rewritten, e.g. by NAT."  \
+    )   \
     val(streaming_socket_timeout_in_ms, uint32_t, 0, Unused,     \
             "Enable or disable socket timeout for streaming operations. When a timeout occurs during streaming, streaming is retried from the start of the current file. Avoid setting this value too low, as it can result in a significant amount of data re-streaming."  \
     )   \
@@ -521,6 +540,10 @@ class config : public utils::config_file {
             "from native_transport_port will use encryption for native_transport_port_ssl while"    \
             "keeping native_transport_port unencrypted" \
     )   \
+    val(native_shard_aware_transport_port, uint16_t, 19042, Used,                \
+            "Like native_transport_port, but clients are forwarded to specific shards, based on the client-side port numbers. " \
+            "Uses the same encryption settings as native_transport_port. Set to 0 to disable."  \
+    )   \
     val(native_transport_max_threads, uint32_t, 128, Invalid,                \
             "The maximum number of thread handling requests. The meaning is the same as rpc_max_threads.\n"  \
             "Default is different (128 versus unlimited).\n"  \
@@ -564,18 +587,24 @@ class config : public utils::config_file {
             "\t         Note: When selecting this option, you must change the default value (unlimited) of rpc_max_threads.\n"   \
             "\tYour own RPC server: You must provide a fully-qualified class name of an o.a.c.t.TServerFactory that can create a server instance."  \
     )   \
+    val(write_batch_window_in_us, uint32_t, 0, Used, \
+            "How long, in microseconds, a coordinator holds small mutations bound for the same replica so that they are sent together in one message. Trades a little latency for fewer messages under many small concurrent writes. 0 disables batching." \
+    ) \
     val(cache_hit_rate_read_balancing, bool, true, Used, \
             "This boolean controls whether the replicas for read query will be choosen based on cache hit ratio"\
     ) \
     /* Advanced fault detection settings */ \
     /* Settings to handle poorly performing or failing nodes. */    \
-    val(dynamic_snitch_badness_threshold, double, 0, Unused,     \
+    val(dynamic_snitch, bool, false, Used,     \
+            "Whether to rank the replicas of each datacenter by their recently observed read latency, pending requests and cache hit rate, steering reads away from replicas that are slow or overloaded. Also enables ordering the replicas of a read by latency and shortening the speculative retry delay of PERCENTILE tables for replicas which are doing well. It moves reads away from the replicas chosen for proximity and cache locality, so it is off by default."  \
+    )   \
+    val(dynamic_snitch_badness_threshold, double, 0.1, Used,     \
             "Sets the performance threshold for dynamically routing requests away from a poorly performing node. A value of 0.2 means Cassandra continues to prefer the static snitch values until the node response time is 20% worse than the best performing node. Until the threshold is reached, incoming client requests are statically routed to the closest replica (as determined by the snitch). Having requests consistently routed to a given replica can help keep a working set of data hot when read repair is less than 1."  \
     )   \
-    val(dynamic_snitch_reset_interval_in_ms, uint32_t, 60000, Unused,     \
+    val(dynamic_snitch_reset_interval_in_ms, uint32_t, 60000, Used,     \
             "Time interval in milliseconds to reset all node scores, which allows a bad node to recover."  \
     )   \
-    val(dynamic_snitch_update_interval_in_ms, uint32_t, 100, Unused,     \
+    val(dynamic_snitch_update_interval_in_ms, uint32_t, 100, Used,     \
             "The time interval for how often the snitch calculates node scores. Because score calculation is CPU intensive, be careful when reducing this interval."  \
     )   \
     val(hinted_handoff_enabled, sstring, "true", Used,     \
@@ -585,6 +614,12 @@ class config : public utils::config_file {
     val(hinted_handoff_throttle_in_kb, uint32_t, 1024, Unused,     \
             "Maximum throttle per delivery thread in kilobytes per second. This rate reduces proportionally to the number of nodes in the cluster. For example, if there are two nodes in the cluster, each delivery thread will use the maximum rate. If there are three, each node will throttle to half of the maximum, since the two nodes are expected to deliver hints simultaneously."  \
     )   \
+    val(hinted_handoff_send_batch_size_in_kb, uint32_t, 256, Used,     \
+            "Hints read from a hints file are coalesced by partition and sent to their destination in batches of up to this size."  \
+    )   \
+    val(hinted_handoff_max_batches_in_flight, uint32_t, 4, Used,     \
+            "Maximum number of hints batches being sent to a single destination node at the same time, per shard."  \
+    )   \
     val(max_hint_window_in_ms, uint32_t, 10800000, Used,     \
             "Maximum amount of time that hints are generates hints for an unresponsive node. After this interval, new hints are no longer generated until the node is back up and responsive. If the node goes down again, a new interval begins. This setting can prevent a sudden demand for resources when a node is brought back online and the rest of the cluster attempts to replay a large volume of hinted writes.\n"  \
             "Related information: Failure detection and recovery"  \
@@ -724,6 +759,8 @@ class config : public utils::config_file {
     val(skip_wait_for_gossip_to_settle, int32_t, -1, Used, "An integer to configure the wait for gossip to settle. -1: wait normally, 0: do not wait at all, n: wait for at most n polls. Same as -Dcassandra.skip_wait_for_gossip_to_settle in cassandra.") \
     val(experimental, bool, false, Used, "Set to true to unlock experimental features.") \
     val(lsa_reclamation_step, size_t, 1, Used, "Minimum number of segments to reclaim in a single step") \
+    val(lsa_huge_pages, bool, false, Used, "Ask the kernel to back memory used by the cache and memtables with transparent huge pages, reducing TLB misses for large caches. Regular pages are used if the kernel doesn't support it") \
+    val(lsa_background_reclaim_free_segments, size_t, 0, Used, "Number of free LSA segments which a background task tries to keep available by compacting or evicting memory ahead of allocations, so that writes don't stall on reclaiming. Set to 0 to disable background reclaim") \
     val(prometheus_port, uint16_t, 9180, Used, "Prometheus port, set to zero to disable") \
     val(prometheus_address, sstring, "0.0.0.0", Used, "Prometheus listening address") \
     val(prometheus_prefix, sstring, "scylla", Used, "Set the prefix of the exported Prometheus metrics. Changing this will break Scylla's dashboard compatibility, do not change unless you know what you are doing.") \
@@ -739,6 +776,12 @@ class config : public utils::config_file {
         " Performance is affected to some extent as a result. Useful to help debugging problems that may arise at another layers.") \
     val(cpu_scheduler, bool, true, Used, "Enable cpu scheduling") \
     val(view_building, bool, true, Used, "Enable view building; should only be set to false when the node is experience issues due to view building") \
+    val(view_building_concurrency, uint32_t, 16, Used, "Number of base partitions per shard whose view updates are generated and sent concurrently while building a view") \
+    val(view_building_shares, uint32_t, 200, Used, "CPU shares of view building, relative to the 1000 shares of statement processing") \
+    val(view_update_max_delay_in_ms, uint32_t, 1000, Used, "Maximum time by which the coordinator delays the completion of a write when the replicas report a full view update backlog") \
+    val(view_update_coalescing_window_in_us, uint32_t, 0, Used, \
+            "How long, in microseconds, view updates generated by base writes are held so that updates to the same view partition are merged and sent together. Trades added view update latency, and longer held view update concurrency units, for fewer view writes under bursts of writes to the same base partitions. 0 disables coalescing." \
+    ) \
     val(enable_sstables_mc_format, bool, false, Used, "Enable SSTables 'mc' format to be used as the default file format; FOR TESTING PURPOSES ONLY - TO BE REMOVED BEFORE RELEASE") \
     /* done! */
 
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2018 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "db/hints/hints_batch.hh"
+#include "dht/i_partitioner.hh"
+
+namespace db {
+namespace hints {
+
+frozen_mutation_and_schema hints_batch::coalesced_hint::release() {
+    if (merged) {
+        return {freeze(*merged), fm_s.s};
+    }
+    return std::move(fm_s);
+}
+
+bool hints_batch::add(frozen_mutation_and_schema m, db::replay_position rp, size_t size, resource_manager::send_units units) {
+    auto key = std::make_tuple(m.s->version(), dht::global_partitioner().get_token(*m.s, m.fm.key(*m.s)), to_bytes(m.fm.key(*m.s).representation()));
+    bool coalesced = false;
+    auto it = _hints.find(key);
+    if (it == _hints.end()) {
+        it = _hints.emplace(std::move(key), coalesced_hint{std::move(m), {}, {}}).first;
+    } else {
+        auto& h = it->second;
+        if (!h.merged) {
+            h.merged = h.fm_s.fm.unfreeze(h.fm_s.s);
+        }
+        h.merged->apply(m.fm.unfreeze(m.s));
+        coalesced = true;
+    }
+    it->second.rps.push_back(rp);
+    _size += size;
+    _units.push_back(std::move(units));
+    return coalesced;
+}
+
+}
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2018 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <map>
+#include <tuple>
+#include <vector>
+#include "db/commitlog/replay_position.hh"
+#include "db/hints/resource_manager.hh"
+#include "frozen_mutation.hh"
+#include "mutation.hh"
+#include "stdx.hh"
+
+namespace db {
+namespace hints {
+
+/// \brief Hints read from a hints file and not sent yet, ordered and coalesced by partition.
+///
+/// Each hint holds the send units of the resource manager it was read with until the batch
+/// is destroyed, so the hints being collected count against the in-flight memory limit.
+class hints_batch {
+public:
+    /// Hints to the same partition, merged into a single mutation.
+    struct coalesced_hint {
+        frozen_mutation_and_schema fm_s;
+        // Set once a second hint has been merged in.
+        stdx::optional<mutation> merged;
+        std::vector<db::replay_position> rps;
+
+        /// \brief The mutation to send, consuming this hint.
+        frozen_mutation_and_schema release();
+    };
+
+    using key_type = std::tuple<table_schema_version, dht::token, bytes>;
+    using map_type = std::map<key_type, coalesced_hint>;
+
+private:
+    map_type _hints;
+    size_t _size = 0;
+    std::vector<resource_manager::send_units> _units;
+
+public:
+    /// \brief Add a hint, merging it into the hint to the same partition if there is one.
+    /// \param m mutation of the hint
+    /// \param rp replay position of the hint
+    /// \param size size of the hint in the file
+    /// \param units send units held by the hint until the batch is destroyed
+    /// \return TRUE if the hint was merged into another one
+    bool add(frozen_mutation_and_schema m, db::replay_position rp, size_t size, resource_manager::send_units units);
+
+    /// \brief Returns true if the batch has to be sent before the send units for a hint of the given size are requested.
+    ///
+    /// The hints of the batch don't release their units until the batch is sent, waiting for units with
+    /// a non-empty batch may never end.
+    bool must_send_before(const resource_manager& rm, size_t size) const {
+        return !empty() && !rm.can_get_send_units_for(size);
+    }
+
+    bool empty() const {
+        return _hints.empty();
+    }
+
+    /// \brief Total size of the hints in the batch, as stored in the hints file.
+    size_t size() const {
+        return _size;
+    }
+
+    /// \brief Number of hints in the batch, after coalescing.
+    size_t partitions() const {
+        return _hints.size();
+    }
+
+    map_type& hints() {
+        return _hints;
+    }
+};
+
+}
+}
@@ -79,6 +79,15 @@ void manager::register_metrics(const sstring& group_name) {
 
         sm::make_derive("sent", _stats.sent,
                         sm::description("Number of sent hints.")),
+
+        sm::make_derive("sent_batches", _stats.sent_batches,
+                        sm::description("Number of batches hints were sent in.")),
+
+        sm::make_derive("sent_bytes", _stats.sent_bytes,
+                        sm::description("Size of sent hints, as stored in the hints files.")),
+
+        sm::make_derive("coalesced", _stats.coalesced,
+                        sm::description("Number of hints merged into another hint to the same partition before being sent.")),
     });
 }
 
@@ -546,6 +555,8 @@ manager::end_point_hints_manager::sender::sender(end_point_hints_manager& parent
     , _hints_cpu_sched_group(_db.get_streaming_scheduling_group())
     , _gossiper(local_gossiper)
     , _file_update_mutex(_ep_manager.file_update_mutex())
+    , _send_batch_size(size_t(local_db.get_config().hinted_handoff_send_batch_size_in_kb()) * 1024)
+    , _batches_in_flight(std::max<size_t>(local_db.get_config().hinted_handoff_max_batches_in_flight(), 1))
 {}
 
 manager::end_point_hints_manager::sender::sender(const sender& other, end_point_hints_manager& parent) noexcept
@@ -559,6 +570,8 @@ manager::end_point_hints_manager::sender::sender(const sender& other, end_point_
     , _hints_cpu_sched_group(other._hints_cpu_sched_group)
     , _gossiper(other._gossiper)
     , _file_update_mutex(_ep_manager.file_update_mutex())
+    , _send_batch_size(other._send_batch_size)
+    , _batches_in_flight(std::max<size_t>(other._db.get_config().hinted_handoff_max_batches_in_flight(), 1))
 {}
 
 
@@ -645,49 +658,87 @@ future<> manager::end_point_hints_manager::sender::send_one_mutation(frozen_muta
 }
 
 future<> manager::end_point_hints_manager::sender::send_one_hint(lw_shared_ptr<send_one_file_ctx> ctx_ptr, temporary_buffer<char> buf, db::replay_position rp, gc_clock::duration secs_since_file_mod, const sstring& fname) {
-    return _resource_manager.get_send_units_for(buf.size()).then([this, secs_since_file_mod, &fname, buf = std::move(buf), rp, ctx_ptr] (auto units) mutable {
-        with_gate(ctx_ptr->file_send_gate, [this, secs_since_file_mod, &fname, buf = std::move(buf), rp, ctx_ptr] () mutable {
+    // The hints of the current batch hold send units until the batch is sent,
+    // don't wait for them to be released without sending the batch first.
+    auto f = make_ready_future<>();
+    if (ctx_ptr->batch.must_send_before(_resource_manager, buf.size())) {
+        f = send_batch(ctx_ptr);
+    }
+    return f.then([this, size = buf.size()] {
+        return _resource_manager.get_send_units_for(size);
+    }).then([this, secs_since_file_mod, &fname, buf = std::move(buf), rp, ctx_ptr] (resource_manager::send_units units) mutable {
+        try {
             try {
-                try {
-                    ctx_ptr->rps_set.emplace(rp);
-                } catch (...) {
-                    // if we failed to insert the rp into the set then its contents can't be trusted and we have to re-send the current file from the beginning
-                    ctx_ptr->state.set(send_state::restart_segment);
-                    ctx_ptr->state.set(send_state::segment_replay_failed);
-                    return make_ready_future<>();
-                }
+                ctx_ptr->rps_set.emplace(rp);
+            } catch (...) {
+                // if we failed to insert the rp into the set then its contents can't be trusted and we have to re-send the current file from the beginning
+                ctx_ptr->state.set(send_state::restart_segment);
+                ctx_ptr->state.set(send_state::segment_replay_failed);
+                return make_ready_future<>();
+            }
 
-                auto m = this->get_mutation(ctx_ptr, buf);
-                gc_clock::duration gc_grace_sec = m.s->gc_grace_seconds();
+            auto m = this->get_mutation(ctx_ptr, buf);
+            gc_clock::duration gc_grace_sec = m.s->gc_grace_seconds();
 
-                // The hint is too old - drop it.
-                //
-                // Files are aggregated for at most manager::hints_timer_period therefore the oldest hint there is
-                // (last_modification - manager::hints_timer_period) old.
-                if (gc_clock::now().time_since_epoch() - secs_since_file_mod > gc_grace_sec - manager::hints_flush_period) {
-                    return make_ready_future<>();
-                }
+            // The hint is too old - drop it.
+            //
+            // Files are aggregated for at most manager::hints_timer_period therefore the oldest hint there is
+            // (last_modification - manager::hints_timer_period) old.
+            if (gc_clock::now().time_since_epoch() - secs_since_file_mod > gc_grace_sec - manager::hints_flush_period) {
+                return make_ready_future<>();
+            }
 
-                return this->send_one_mutation(std::move(m)).then([this, rp, ctx_ptr] {
-                    ctx_ptr->rps_set.erase(rp);
-                    ++this->shard_stats().sent;
+            if (ctx_ptr->batch.add(std::move(m), rp, buf.size(), std::move(units))) {
+                ++shard_stats().coalesced;
+            }
+            if (ctx_ptr->batch.size() >= _send_batch_size) {
+                return send_batch(std::move(ctx_ptr));
+            }
+
+        // ignore these errors and move on - probably this hint is too old and the KS/CF has been deleted...
+        } catch (no_such_column_family& e) {
+            manager_logger.debug("send_hints(): no_such_column_family: {}", e.what());
+        } catch (no_such_keyspace& e) {
+            manager_logger.debug("send_hints(): no_such_keyspace: {}", e.what());
+        } catch (no_column_mapping& e) {
+            manager_logger.debug("send_hints(): {}: {}", fname, e.what());
+        }
+        return make_ready_future<>();
+    }).handle_exception([this, ctx_ptr] (auto eptr) {
+        manager_logger.trace("send_one_hint(): Hmmm. Something bad had happend: {}", eptr);
+        ctx_ptr->state.set(send_state::segment_replay_failed);
+    });
+}
+
+future<> manager::end_point_hints_manager::sender::send_batch(lw_shared_ptr<send_one_file_ctx> ctx_ptr) {
+    if (ctx_ptr->batch.empty()) {
+        return make_ready_future<>();
+    }
+    // The batch keeps holding the send units of its hints until it has been sent.
+    auto batch = make_lw_shared<hints_batch>(std::exchange(ctx_ptr->batch, hints_batch()));
+
+    return get_units(_batches_in_flight, 1).then([this, ctx_ptr, batch] (auto batch_units) mutable {
+        with_gate(ctx_ptr->file_send_gate, [this, ctx_ptr, batch] () mutable {
+            ++shard_stats().sent_batches;
+            return parallel_for_each(batch->hints(), [this, ctx_ptr] (hints_batch::map_type::value_type& e) {
+                auto& h = e.second;
+                return futurize_apply([this, &h] {
+                    return this->send_one_mutation(h.release());
+                }).then([this, ctx_ptr, &h] {
+                    for (auto&& rp : h.rps) {
+                        ctx_ptr->rps_set.erase(rp);
+                    }
+                    this->shard_stats().sent += h.rps.size();
                 }).handle_exception([this, ctx_ptr] (auto eptr) {
-                    manager_logger.trace("send_one_hint(): failed to send to {}: {}", end_point_key(), eptr);
+                    manager_logger.trace("send_batch(): failed to send to {}: {}", end_point_key(), eptr);
                     ctx_ptr->state.set(send_state::segment_replay_failed);
                 });
-
-            // ignore these errors and move on - probably this hint is too old and the KS/CF has been deleted...
-            } catch (no_such_column_family& e) {
-                manager_logger.debug("send_hints(): no_such_column_family: {}", e.what());
-            } catch (no_such_keyspace& e) {
-                manager_logger.debug("send_hints(): no_such_keyspace: {}", e.what());
-            } catch (no_column_mapping& e) {
-                manager_logger.debug("send_hints(): {}: {}", fname, e.what());
-            }
-            return make_ready_future<>();
-        }).finally([units = std::move(units), ctx_ptr] {});
+            }).then([this, batch] {
+                this->shard_stats().sent_bytes += batch->size();
+            });
+        }).finally([batch, batch_units = std::move(batch_units), ctx_ptr] {});
     }).handle_exception([this, ctx_ptr] (auto eptr) {
-        manager_logger.trace("send_one_file(): Hmmm. Something bad had happend: {}", eptr);
+        manager_logger.trace("send_batch(): Hmmm. Something bad had happend: {}", eptr);
         ctx_ptr->state.set(send_state::segment_replay_failed);
     });
 }
@@ -718,6 +769,7 @@ bool manager::end_point_hints_manager::sender::send_one_file(const sstring& fnam
         }, _last_not_complete_rp.pos, &_db.get_config().extensions()).get0();
 
         s->done().get();
+        send_batch(ctx_ptr).get();
     } catch (...) {
         manager_logger.trace("sending of {} failed: {}", fname, std::current_exception());
         ctx_ptr->state.set(send_state::segment_replay_failed);
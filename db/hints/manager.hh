@@ -25,8 +25,10 @@
 #include <unordered_map>
 #include <vector>
 #include <list>
+#include <map>
 #include <chrono>
 #include <seastar/core/gate.hh>
+#include <seastar/core/semaphore.hh>
 #include <seastar/core/sharded.hh>
 #include <seastar/core/timer.hh>
 #include <seastar/core/lowres_clock.hh>
@@ -36,8 +38,10 @@
 #include "locator/snitch_base.hh"
 #include "service/endpoint_lifecycle_subscriber.hh"
 #include "db/commitlog/commitlog.hh"
+#include "mutation.hh"
 #include "utils/loading_shared_values.hh"
 #include "db/hints/resource_manager.hh"
+#include "db/hints/hints_batch.hh"
 
 namespace service {
 class storage_service;
@@ -59,6 +63,9 @@ class manager : public service::endpoint_lifecycle_subscriber {
         uint64_t errors = 0;
         uint64_t dropped = 0;
         uint64_t sent = 0;
+        uint64_t sent_batches = 0;
+        uint64_t sent_bytes = 0;
+        uint64_t coalesced = 0;
     };
 
     // map: shard -> segments
@@ -104,8 +111,13 @@ class manager : public service::endpoint_lifecycle_subscriber {
             struct send_one_file_ctx {
                 std::unordered_map<table_schema_version, column_mapping> schema_ver_to_column_mapping;
                 seastar::gate file_send_gate;
-                std::unordered_set<db::replay_position> rps_set; // number of elements in this set is never going to be greater than the maximum send queue length
+                // Replay positions of the hints read from the file and not sent yet. Each hint kept in memory,
+                // in the batch being collected or in flight, holds send units of the resource manager, so at
+                // most resource_manager::max_hints_send_queue_length of them are pending at a time. Positions
+                // of dropped hints (too old, or of a dropped table) are not removed until the file is done.
+                std::unordered_set<db::replay_position> rps_set;
                 send_state_set state;
+                hints_batch batch;
             };
 
         private:
@@ -124,6 +136,8 @@ class manager : public service::endpoint_lifecycle_subscriber {
             seastar::scheduling_group _hints_cpu_sched_group;
             gms::gossiper& _gossiper;
             seastar::shared_mutex& _file_update_mutex;
+            const size_t _send_batch_size;
+            seastar::semaphore _batches_in_flight;
 
         public:
             sender(end_point_hints_manager& parent, service::storage_proxy& local_storage_proxy, database& local_db, gms::gossiper& local_gossiper) noexcept;
@@ -187,11 +201,13 @@ class manager : public service::endpoint_lifecycle_subscriber {
             }
 
             /// \brief Try to send one hint read from the file.
-            ///  - Limit the maximum memory size of hints "in the air" and the maximum total number of hints "in the air".
+            ///  - Limit the maximum memory size of hints "in the air", counting the batch being collected.
             ///  - Discard the hints that are older than the grace seconds value of the corresponding table.
+            ///  - Add the hint to the current batch, coalescing it with the hints to the same partition.
+            ///  - Send the batch out if it's big enough.
             ///
-            /// If sending fails we are going to clear the state::segment_replay_ok in the _state and \ref rp is going to be stored in the _rps_set.
-            /// If sending is successful then \ref rp is going to be removed from the _rps_set.
+            /// \ref rp is stored in the _rps_set until the batch holding the hint is sent successfully.
+            /// If sending fails we are going to set send_state::segment_replay_failed in the context state.
             ///
             /// \param ctx_ptr shared pointer to the file sending context
             /// \param buf buffer representing the hint
@@ -201,6 +217,14 @@ class manager : public service::endpoint_lifecycle_subscriber {
             /// \return future that resolves when next hint may be sent
             future<> send_one_hint(lw_shared_ptr<send_one_file_ctx> ctx_ptr, temporary_buffer<char> buf, db::replay_position rp, gc_clock::duration secs_since_file_mod, const sstring& fname);
 
+            /// \brief Send the current batch out in the background.
+            ///  - Limit the number of batches "in the air".
+            ///  - Send the mutations of the batch concurrently.
+            ///
+            /// \param ctx_ptr shared pointer to the file sending context
+            /// \return future that resolves when the next batch may be collected
+            future<> send_batch(lw_shared_ptr<send_one_file_ctx> ctx_ptr);
+
             /// \brief Send all hint from a single file and delete it after it has been successfully sent.
             /// Send all hints from the given file. If we failed to send the current segment we will pick up in the next
             /// iteration from where we left in this one.
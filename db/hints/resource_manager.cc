@@ -52,11 +52,15 @@ future<bool> is_mountpoint(const fs::path& path) {
     });
 }
 
-future<semaphore_units<semaphore_default_exception_factory>> resource_manager::get_send_units_for(size_t buf_size) {
+size_t resource_manager::send_budget_for(size_t buf_size) const {
     // Let's approximate the memory size the mutation is going to consume by the size of its serialized form
     size_t hint_memory_budget = std::max(_min_send_hint_budget, buf_size);
     // Allow a very big mutation to be sent out by consuming the whole shard budget
-    hint_memory_budget = std::min(hint_memory_budget, _max_send_in_flight_memory);
+    return std::min(hint_memory_budget, _max_send_in_flight_memory);
+}
+
+future<resource_manager::send_units> resource_manager::get_send_units_for(size_t buf_size) {
+    size_t hint_memory_budget = send_budget_for(buf_size);
     resource_manager_logger.trace("memory budget: need {} have {}", hint_memory_budget, _send_limiter.available_units());
     return get_units(_send_limiter, hint_memory_budget);
 }
@@ -124,6 +124,8 @@ class resource_manager {
     space_watchdog::per_device_limits_map _per_device_limits_map;
     space_watchdog _space_watchdog;
 
+    size_t send_budget_for(size_t buf_size) const;
+
 public:
     static constexpr uint64_t max_size_of_hints_in_progress = 10 * 1024 * 1024; // 10MB
     static constexpr size_t hint_segment_size_in_mb = 32;
@@ -141,7 +143,14 @@ class resource_manager {
     resource_manager(resource_manager&&) = delete;
     resource_manager& operator=(resource_manager&&) = delete;
 
-    future<semaphore_units<semaphore_default_exception_factory>> get_send_units_for(size_t buf_size);
+    using send_units = semaphore_units<semaphore_default_exception_factory>;
+
+    future<send_units> get_send_units_for(size_t buf_size);
+
+    /// \brief Returns true if get_send_units_for(buf_size) would not have to wait.
+    bool can_get_send_units_for(size_t buf_size) const {
+        return _send_limiter.waiters() == 0 && _send_limiter.available_units() >= ssize_t(send_budget_for(buf_size));
+    }
 
     bool too_many_hints_in_progress() const {
         return _size_of_hints_in_progress > max_size_of_hints_in_progress;
@@ -1012,6 +1012,9 @@ static void merge_tables_and_views(distributed<service::storage_proxy>& proxy,
                 auto& s = *dt.schema.get();
                 return db.drop_column_family(s.ks_name(), s.cf_name(), [&] { return dt.jp.value(); });
             }).get();
+            for (auto&& dt : boost::range::join(tables_diff.dropped, views_diff.dropped)) {
+                proxy.local().forget_range_scan_estimate(dt.schema.get()->id());
+            }
             parallel_for_each(boost::range::join(tables_diff.created, views_diff.created), [&] (global_schema_ptr& gs) {
                 return db.add_column_family_and_make_directory(gs);
             }).get();
@@ -1012,10 +1012,79 @@ future<> mutate_MV(const dht::token& base_token, std::vector<mutation> mutations
     return f.finally([fs = std::move(fs)] { });
 }
 
-view_builder::view_builder(database& db, db::system_distributed_keyspace& sys_dist_ks, service::migration_manager& mm)
+view_update_coalescer::view_update_coalescer(std::chrono::microseconds window, stats& stats)
+        : view_update_coalescer(window, stats, [&stats] (dht::token base_token, std::vector<mutation> updates) {
+            return mutate_MV(base_token, std::move(updates), stats);
+        }) {
+}
+
+view_update_coalescer::view_update_coalescer(std::chrono::microseconds window, stats& stats, send_func send)
+        : _window(window)
+        , _stats(stats)
+        , _send(std::move(send))
+        , _timer([this] { flush(); }) {
+}
+
+void view_update_coalescer::add(dht::token base_token, std::vector<mutation> updates, units_type units) {
+    if (!_window.count() || _gate.is_closed()) {
+        (void)futurize_apply(_send, std::move(base_token), std::move(updates)).handle_exception([units = std::move(units)] (auto ignored) { });
+        return;
+    }
+    for (auto&& m : updates) {
+        auto key = key_type(base_token, m.schema()->version(), to_bytes(m.key().representation()));
+        auto it = _pending.find(key);
+        if (it == _pending.end()) {
+            _pending.emplace(std::move(key), std::move(m));
+        } else {
+            it->second.apply(std::move(m));
+            ++_stats.view_updates_coalesced;
+        }
+    }
+    _pending_units.push_back(std::move(units));
+    if (_pending_units.size() >= max_pending_base_writes) {
+        _timer.cancel();
+        flush();
+    } else if (!_timer.armed()) {
+        _timer.arm(_window);
+    }
+}
+
+void view_update_coalescer::flush() {
+    if (_pending_units.empty()) {
+        return;
+    }
+    // _pending is ordered by base token, so the updates of each base token are adjacent.
+    std::vector<std::pair<dht::token, std::vector<mutation>>> batches;
+    for (auto&& e : _pending) {
+        auto& base_token = std::get<0>(e.first);
+        if (batches.empty() || batches.back().first != base_token) {
+            batches.emplace_back(base_token, std::vector<mutation>());
+        }
+        batches.back().second.push_back(std::move(e.second));
+    }
+    _pending.clear();
+    auto units = std::exchange(_pending_units, {});
+    (void)with_gate(_gate, [this, batches = std::move(batches), units = std::move(units)] () mutable {
+        return do_with(std::move(batches), std::move(units), [this] (auto& batches, auto&) {
+            return parallel_for_each(batches, [this] (auto& batch) {
+                return futurize_apply(_send, batch.first, std::move(batch.second)).handle_exception([] (auto ignored) { });
+            });
+        });
+    });
+}
+
+future<> view_update_coalescer::stop() {
+    _timer.cancel();
+    flush();
+    return _gate.close();
+}
+
+view_builder::view_builder(database& db, db::system_distributed_keyspace& sys_dist_ks, service::migration_manager& mm,
+        seastar::scheduling_group sg)
         : _db(db)
         , _sys_dist_ks(sys_dist_ks)
-        , _mm(mm) {
+        , _mm(mm)
+        , _scheduling_group(sg) {
 }
 
 future<> view_builder::start() {
@@ -1381,7 +1450,9 @@ void view_builder::on_drop_view(const sstring& ks_name, const sstring& view_name
 }
 
 future<> view_builder::do_build_step() {
-    return seastar::async([this] {
+    seastar::thread_attributes attr;
+    attr.sched_group = _scheduling_group;
+    return seastar::async(std::move(attr), [this] {
         exponential_backoff_retry r(1s, 1min);
         while (!_base_to_build_step.empty() && !_as.abort_requested()) {
             auto units = get_units(_sem, 1).get0();
@@ -1408,6 +1479,34 @@ future<> view_builder::do_build_step() {
     });
 }
 
+// The view updates of the base partitions consumed by a build step, which are still being sent.
+struct view_builder::pending_view_updates {
+    seastar::semaphore sem;
+    std::vector<future<>> updates;
+
+    explicit pending_view_updates(size_t concurrency)
+            : sem(std::max(concurrency, size_t(1))) {
+    }
+
+    // Called in the context of a seastar::thread. Rethrows the first failure.
+    void wait() {
+        auto results = when_all(updates.begin(), updates.end()).get0();
+        updates.clear();
+        std::exception_ptr ep;
+        for (auto& f : results) {
+            if (f.failed()) {
+                auto e = f.get_exception();
+                if (!ep) {
+                    ep = std::move(e);
+                }
+            }
+        }
+        if (ep) {
+            std::rethrow_exception(std::move(ep));
+        }
+    }
+};
+
 // Called in the context of a seastar::thread.
 class view_builder::consumer {
 public:
@@ -1439,14 +1538,16 @@ class view_builder::consumer {
 private:
     view_builder& _builder;
     build_step& _step;
+    pending_view_updates& _pending;
     built_views _built_views;
     std::vector<view_ptr> _views_to_build;
     std::deque<mutation_fragment> _fragments;
 
 public:
-    consumer(view_builder& builder, build_step& step)
+    consumer(view_builder& builder, build_step& step, pending_view_updates& pending)
             : _builder(builder)
             , _step(step)
+            , _pending(pending)
             , _built_views{step} {
         if (!step.current_key.key().is_empty(*_step.reader.schema())) {
             load_views_to_build();
@@ -1517,10 +1618,11 @@ class view_builder::consumer {
         _builder._as.check();
         if (!_fragments.empty()) {
             _fragments.push_front(partition_start(_step.current_key, tombstone()));
-            _step.base->populate_views(
+            auto units = get_units(_pending.sem, 1).get0();
+            _pending.updates.push_back(_step.base->populate_views(
                     _views_to_build,
                     _step.current_token(),
-                    make_flat_mutation_reader_from_fragments(_step.base->schema(), std::move(_fragments))).get();
+                    make_flat_mutation_reader_from_fragments(_step.base->schema(), std::move(_fragments))).finally([units = std::move(units)] { }));
             _fragments.clear();
         }
         return stop_iteration(_step.build_status.empty());
@@ -1549,15 +1651,35 @@ class view_builder::consumer {
 
 // Called in the context of a seastar::thread.
 void view_builder::execute(build_step& step, exponential_backoff_retry r) {
+    // If some view updates of this step fail to be sent, we rewind the step to where it started,
+    // since the partitions they belong to may already be behind the current token.
+    auto start_key = step.current_key;
+    auto start_status = step.build_status;
+    pending_view_updates pending(_db.get_config().view_building_concurrency());
     auto consumer = compact_for_query<emit_only_live_rows::yes, view_builder::consumer>(
             *step.reader.schema(),
             gc_clock::now(),
             step.pslice,
             batch_size,
             query::max_partitions,
-            view_builder::consumer{*this, step});
+            view_builder::consumer{*this, step, pending});
     consumer.consume_new_partition(step.current_key); // Initialize the state in case we're resuming a partition
-    auto built = step.reader.consume_in_thread(std::move(consumer), db::no_timeout);
+    auto built = [&] {
+        try {
+            auto result = step.reader.consume_in_thread(std::move(consumer), db::no_timeout);
+            pending.wait();
+            return result;
+        } catch (...) {
+            try {
+                pending.wait();
+            } catch (...) {
+                // We're already failing the step.
+            }
+            step.current_key = std::move(start_key);
+            step.build_status = std::move(start_status);
+            throw;
+        }
+    }();
 
     _as.check();
 
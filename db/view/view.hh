@@ -29,6 +29,14 @@
 #include "mutation_fragment.hh"
 #include "flat_mutation_reader.hh"
 #include "stdx.hh"
+#include "db/timeout_clock.hh"
+
+#include <map>
+
+#include <seastar/core/gate.hh>
+#include <seastar/core/semaphore.hh>
+#include <seastar/core/timer.hh>
+#include <seastar/util/noncopyable_function.hh>
 
 namespace db {
 
@@ -39,6 +47,7 @@ struct stats : public service::storage_proxy_stats::write_stats {
     int64_t view_updates_pushed_remote = 0;
     int64_t view_updates_failed_local = 0;
     int64_t view_updates_failed_remote = 0;
+    int64_t view_updates_coalesced = 0;
 
     stats(const sstring& category) : service::storage_proxy_stats::write_stats(category, false) { }
 };
@@ -104,6 +113,50 @@ query::clustering_row_ranges calculate_affected_clustering_ranges(
 
 future<> mutate_MV(const dht::token& base_token, std::vector<mutation> mutations, db::view::stats& stats);
 
+/**
+ * Coalesces the view updates generated by the base writes of a table over a
+ * short window before pushing them to the view replicas.
+ *
+ * Updates to the same view partition, generated for the same base token, are
+ * merged into a single mutation, so a burst of writes to a base partition
+ * results in one update per view partition instead of one per base write.
+ * The updates of each base token are then sent together, with a single call
+ * to mutate_MV(), which pairs them with the same view replicas.
+ *
+ * Each added batch of updates holds units of the view update concurrency
+ * semaphore, which are released only once the updates were sent, so the
+ * coalescer doesn't weaken the limit on pending view updates.
+ */
+class view_update_coalescer {
+public:
+    using units_type = seastar::semaphore_units<seastar::default_timeout_exception_factory, db::timeout_clock>;
+    // Sends the view updates generated for a base token.
+    using send_func = noncopyable_function<future<> (dht::token, std::vector<mutation>)>;
+private:
+    // Flush early once this many base writes are waiting, so that the
+    // coalescer doesn't end up holding most of the semaphore units.
+    static constexpr size_t max_pending_base_writes = 32;
+    using key_type = std::tuple<dht::token, table_schema_version, bytes>;
+    std::chrono::microseconds _window;
+    stats& _stats;
+    send_func _send;
+    std::map<key_type, mutation> _pending;
+    std::vector<units_type> _pending_units;
+    timer<> _timer;
+    seastar::gate _gate;
+public:
+    // A zero window disables coalescing. Updates are sent with mutate_MV().
+    view_update_coalescer(std::chrono::microseconds window, stats& stats);
+    view_update_coalescer(std::chrono::microseconds window, stats& stats, send_func send);
+
+    void add(dht::token base_token, std::vector<mutation> updates, units_type units);
+
+    // Pushes out the pending updates and waits for all sends to complete.
+    future<> stop();
+private:
+    void flush();
+};
+
 /**
  * create_virtual_column() adds a "virtual column" to a schema builder.
  * The definition of a "virtual column" is based on the given definition
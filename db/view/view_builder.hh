@@ -37,6 +37,7 @@
 #include <seastar/core/abort_source.hh>
 #include <seastar/core/future.hh>
 #include <seastar/core/lowres_clock.hh>
+#include <seastar/core/scheduling.hh>
 #include <seastar/core/semaphore.hh>
 #include <seastar/core/sharded.hh>
 #include <seastar/core/shared_future.hh>
@@ -59,9 +60,11 @@ namespace db::view {
  * from one reader. We also strive for fairness, in that each build step inserts entries for
  * the views of a different base. Each build step reads and generates updates for batch_size rows.
  *
- * We lack a controller, which could potentially allow us to go faster (to execute multiple steps at
- * the same time, or consume more rows per batch), and also which would apply backpressure, so we
- * could, for example, delay executing a build step.
+ * Within a build step, the view updates of up to view_building_concurrency base partitions are
+ * generated and sent at the same time, so that the step isn't bound by the latency of the view
+ * writes. The progress of a step is only recorded once all its view updates were sent; if any
+ * of them fails, the whole step is redone. Building runs in its own scheduling group, whose
+ * shares bound the resources it takes from the rest of the node.
  *
  * View building is necessarily a sharded process. That means that on restart, if the number of shards
  * has changed, we need to calculate the most conservative token range that has been built, and build
@@ -140,6 +143,7 @@ class view_builder final : public service::migration_listener::only_view_notific
     database& _db;
     db::system_distributed_keyspace& _sys_dist_ks;
     service::migration_manager& _mm;
+    seastar::scheduling_group _scheduling_group;
     base_to_build_step_type _base_to_build_step;
     base_to_build_step_type::iterator _current_step = _base_to_build_step.end();
     serialized_action _build_step{std::bind(&view_builder::do_build_step, this)};
@@ -162,7 +166,8 @@ class view_builder final : public service::migration_listener::only_view_notific
     static constexpr size_t batch_size = 128;
 
 public:
-    view_builder(database&, db::system_distributed_keyspace&, service::migration_manager&);
+    view_builder(database&, db::system_distributed_keyspace&, service::migration_manager&,
+            seastar::scheduling_group sg = seastar::default_scheduling_group());
     view_builder(view_builder&&) = delete;
 
     /**
@@ -196,6 +201,7 @@ class view_builder final : public service::migration_listener::only_view_notific
     future<> maybe_mark_view_as_built(view_ptr, dht::token);
 
     struct consumer;
+    struct pending_view_updates;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2018 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include "stdx.hh"
+
+namespace db {
+
+namespace view {
+
+/**
+ * The view update backlog of a replica: the memory taken by view updates
+ * which were generated by the replica and not yet acknowledged by the view
+ * replicas, out of the maximum the replica allows before it starts blocking
+ * base writes.
+ *
+ * Replicas return their backlog to the coordinator in write responses, and
+ * the coordinator delays the completion of writes proportionally to it, so
+ * that clients slow down before the replicas run out of memory.
+ */
+struct update_backlog {
+    uint64_t current;
+    uint64_t max;
+
+    float relative_size() const {
+        return float(current) / float(max);
+    }
+
+    bool operator<(const update_backlog& rhs) const {
+        return relative_size() < rhs.relative_size();
+    }
+
+    static update_backlog no_backlog() {
+        return update_backlog{0, std::numeric_limits<uint64_t>::max()};
+    }
+};
+
+/**
+ * Returns the larger of the backlog gathered so far for a write and the one
+ * a replica reported along with its response. Replicas which don't report
+ * a backlog, like ones running an older version, leave it unchanged.
+ */
+inline update_backlog max_backlog(update_backlog current, const stdx::optional<update_backlog>& reported) {
+    return reported ? std::max(current, *reported) : current;
+}
+
+/**
+ * Returns by how much to delay acknowledging a write, out of the given budget,
+ * when the replicas of the write reported the given backlog. The delay grows
+ * with the cube of the relative backlog: zero for an empty backlog, the whole
+ * budget for a full one.
+ */
+template<typename Duration>
+inline Duration throttling_delay(update_backlog backlog, Duration budget) {
+    auto relative = std::min(backlog.relative_size(), 1.0f);
+    if (!(relative > 0) || budget <= Duration::zero()) {
+        return Duration::zero();
+    }
+    return std::chrono::duration_cast<Duration>(budget * (relative * relative * relative));
+}
+
+}
+
+}
@@ -246,6 +246,14 @@ class versioned_value {
             return versioned_value(hitrates);
         }
 
+        versioned_value shard_count(unsigned shard_count) {
+            return versioned_value(to_sstring(shard_count));
+        }
+
+        versioned_value ignore_msb_bits(unsigned ignore_msb_bits) {
+            return versioned_value(to_sstring(ignore_msb_bits));
+        }
+
     };
 }; // class versioned_value
 
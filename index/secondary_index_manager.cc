@@ -55,6 +55,7 @@ namespace secondary_index {
 index::index(const sstring& target_column, const index_metadata& im)
     : _target_column{target_column}
     , _im{im}
+    , _local{is_local_index(im)}
 {}
 
 bool index::depends_on(const column_definition& cdef) const {
@@ -98,6 +99,11 @@ sstring index_table_name(const sstring& index_name) {
     return format("{}_index", index_name);
 }
 
+bool is_local_index(const index_metadata& im) {
+    auto it = im.options().find(cql3::statements::index_target::local_option_name);
+    return it != im.options().end() && it->second == "true";
+}
+
 static bytes get_available_token_column_name(const schema& schema) {
     bytes base_name = "idx_token";
     bytes accepted_name = base_name;
@@ -118,6 +124,23 @@ view_ptr secondary_index_manager::create_view_for_index(const index_metadata& im
     if (target_type != cql3::statements::index_target::target_type::values) {
         throw std::runtime_error(format("Unsupported index target type: {}", to_sstring(target_type)));
     }
+    if (is_local_index(im)) {
+        // The index view shares the base partition key, and is clustered by
+        // the indexed value followed by the rest of the base clustering key.
+        for (auto& col : schema->partition_key_columns()) {
+            builder.with_column(col.name(), col.type, column_kind::partition_key);
+        }
+        builder.with_column(index_target->name(), index_target->type, column_kind::clustering_key);
+        for (auto& col : schema->clustering_key_columns()) {
+            if (col == *index_target) {
+                continue;
+            }
+            builder.with_column(col.name(), col.type, column_kind::clustering_key);
+        }
+        const sstring where_clause = format("{} IS NOT NULL", cql3::util::maybe_quote(index_target_name));
+        builder.with_view_info(*schema, false, where_clause);
+        return view_ptr{builder.build()};
+    }
     builder.with_column(index_target->name(), index_target->type, column_kind::partition_key);
     // Additional token column is added to ensure token order on secondary index queries
     bytes token_column_name = get_available_token_column_name(*schema);
@@ -52,9 +52,14 @@ namespace secondary_index {
 
 sstring index_table_name(const sstring& index_name);
 
+// A local index is partitioned by the base partition key rather than by the
+// indexed value, so its entries live on the same replicas as the base rows.
+bool is_local_index(const index_metadata& im);
+
 class index {
     sstring _target_column;
     index_metadata _im;
+    bool _local;
 public:
     index(const sstring& target_column, const index_metadata& im);
     bool depends_on(const column_definition& cdef) const;
@@ -63,6 +68,9 @@ class index {
     const sstring& target_column() const {
         return _target_column;
     }
+    bool is_local() const {
+        return _local;
+    }
 };
 
 class secondary_index_manager {
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2018 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "locator/dynamic_snitch.hh"
+#include "locator/snitch_base.hh"
+
+namespace locator {
+
+dynamic_snitch::dynamic_snitch(config cfg)
+    : _cfg(std::move(cfg))
+    , _update_timer([this] { update_scores(); })
+    , _reset_timer([this] { reset(); })
+{
+    if (_cfg.enabled) {
+        _update_timer.arm_periodic(_cfg.update_interval);
+        if (_cfg.reset_interval.count()) {
+            _reset_timer.arm_periodic(_cfg.reset_interval);
+        }
+    }
+}
+
+// Nothing is tracked while disabled, so all estimates stay disengaged and
+// reads keep the order the static snitch and the replica selection chose.
+void dynamic_snitch::request_started(inet_address ep) {
+    if (!_cfg.enabled) {
+        return;
+    }
+    ++_stats[ep].pending;
+}
+
+void dynamic_snitch::request_completed(inet_address ep, duration latency) {
+    if (!_cfg.enabled) {
+        return;
+    }
+    auto& s = _stats[ep];
+    --s.pending;
+    s.latency.add(latency);
+}
+
+void dynamic_snitch::record_cache_hit_rate(inet_address ep, float hit_rate) {
+    if (_cfg.enabled && hit_rate >= 0) {
+        _stats[ep].hit_rate = std::min(hit_rate, 1.0f);
+    }
+}
+
+stdx::optional<dynamic_snitch::duration> dynamic_snitch::latency_mean(inet_address ep) const {
+    if (!_cfg.enabled) {
+        return stdx::nullopt;
+    }
+    auto it = _stats.find(ep);
+    if (it == _stats.end() || !it->second.latency.is_fresh(latency_max_age)) {
+        return stdx::nullopt;
+    }
+    return it->second.latency.mean();
+}
+
+stdx::optional<dynamic_snitch::duration> dynamic_snitch::latency_high_estimate(inet_address ep) const {
+    if (!_cfg.enabled) {
+        return stdx::nullopt;
+    }
+    auto it = _stats.find(ep);
+    if (it == _stats.end() || !it->second.latency.is_fresh(latency_max_age)) {
+        return stdx::nullopt;
+    }
+    return it->second.latency.high_estimate();
+}
+
+void dynamic_snitch::update_scores() {
+    _scores.clear();
+    for (auto&& e : _stats) {
+        auto& s = e.second;
+        if (!s.latency.has_samples()) {
+            continue;
+        }
+        auto latency = std::chrono::duration<double, std::micro>(s.latency.mean()).count();
+        _scores.emplace(e.first, latency * (1 + s.pending) * (1 - cache_hit_rate_weight * s.hit_rate));
+    }
+}
+
+void dynamic_snitch::reset() {
+    // Keep the pending request counts, they are still accurate.
+    for (auto&& e : _stats) {
+        e.second.latency = utils::latency_estimator();
+    }
+    _scores.clear();
+}
+
+// Replicas without a score yet rank first, so that they get one.
+double dynamic_snitch::score(inet_address ep) const {
+    auto it = _scores.find(ep);
+    return it == _scores.end() ? 0 : it->second;
+}
+
+void dynamic_snitch::sort_by_score(std::vector<inet_address>& addresses) const {
+    if (!_cfg.enabled || _scores.empty() || addresses.size() < 2) {
+        return;
+    }
+    auto& snitch = i_endpoint_snitch::get_local_snitch_ptr();
+    std::unordered_map<sstring, std::vector<size_t>> positions_by_dc;
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        positions_by_dc[snitch->get_datacenter(addresses[i])].push_back(i);
+    }
+    std::vector<std::pair<double, inet_address>> ranked;
+    for (auto&& e : positions_by_dc) {
+        auto& positions = e.second;
+        if (positions.size() < 2) {
+            continue;
+        }
+        ranked.clear();
+        for (auto pos : positions) {
+            ranked.emplace_back(score(addresses[pos]), addresses[pos]);
+        }
+        auto best = std::min_element(ranked.begin(), ranked.end(), [] (auto& a, auto& b) { return a.first < b.first; })->first;
+        if (ranked.front().first <= best * (1 + _cfg.badness_threshold)) {
+            continue;
+        }
+        std::stable_sort(ranked.begin(), ranked.end(), [] (auto& a, auto& b) { return a.first < b.first; });
+        for (size_t i = 0; i < positions.size(); ++i) {
+            addresses[positions[i]] = ranked[i].second;
+        }
+    }
+}
+
+// Orders the replicas contacted up front by their recent latency, so that
+// the data request goes to the fastest one. If the extra replica, which is
+// only contacted when speculating, has recently been much faster than the
+// slowest of them and is in the same datacenter, the two trade places, so a
+// replica that is slow right now is only read from if another one is late.
+//
+// The order the targets were chosen in, which accounts for proximity, cache
+// hit rates and preferred endpoints, is kept unless the replica it prefers
+// is slower than the fastest one by more than the badness threshold. Without
+// fresh estimates for all of the replicas it is kept too; estimates of
+// replicas we stop reading from expire, which lets them back in.
+void dynamic_snitch::order_by_latency(std::vector<inet_address>& targets, bool has_extra_replica) const {
+    if (!_cfg.enabled) {
+        return;
+    }
+    auto contacted_end = has_extra_replica ? targets.end() - 1 : targets.end();
+    std::vector<std::pair<duration, inet_address>> by_latency;
+    by_latency.reserve(targets.size());
+    for (auto it = targets.begin(); it != contacted_end; ++it) {
+        auto mean = latency_mean(*it);
+        if (!mean) {
+            return;
+        }
+        by_latency.emplace_back(*mean, *it);
+    }
+    if (by_latency.empty()) {
+        return;
+    }
+    auto preferred = by_latency.front().first;
+    auto by_mean = [] (auto& a, auto& b) { return a.first < b.first; };
+    std::stable_sort(by_latency.begin(), by_latency.end(), by_mean);
+    bool swapped = false;
+    if (has_extra_replica) {
+        auto extra_mean = latency_mean(targets.back());
+        auto& slowest = by_latency.back();
+        auto& snitch = i_endpoint_snitch::get_local_snitch_ptr();
+        if (extra_mean && *extra_mean * 2 < slowest.first
+                && snitch->get_datacenter(targets.back()) == snitch->get_datacenter(slowest.second)) {
+            std::swap(slowest.second, targets.back());
+            slowest.first = *extra_mean;
+            std::stable_sort(by_latency.begin(), by_latency.end(), by_mean);
+            swapped = true;
+        }
+    }
+    if (!swapped && preferred <= by_latency.front().first * (1 + _cfg.badness_threshold)) {
+        return;
+    }
+    for (size_t i = 0; i < by_latency.size(); ++i) {
+        targets[i] = by_latency[i].second;
+    }
+}
+
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2018 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+#include <seastar/core/lowres_clock.hh>
+#include <seastar/core/timer.hh>
+
+#include "gms/inet_address.hh"
+#include "seastarx.hh"
+#include "stdx.hh"
+#include "utils/latency_estimator.hh"
+
+namespace locator {
+
+/**
+ * Ranks the replicas of each datacenter by how well they have been
+ * answering reads lately, so that reads steer away from replicas that are
+ * slow or overloaded right now.
+ *
+ * Works on top of the configured snitch rather than replacing it: the
+ * snitch still decides the order of datacenters, and the dynamic snitch
+ * only reorders replicas among the places the snitch gave to their
+ * datacenter. The snitch's choice is kept unless the replica it prefers
+ * scores worse than the best one by more than the badness threshold, so
+ * reads stick to the same replicas (and their warm caches) while all of
+ * them are doing fine.
+ *
+ * A replica's score is its smoothed read latency, multiplied by the number
+ * of requests we have pending on it and lowered by its cache hit rate, so
+ * lower is better. Scores are recomputed every update interval, and all
+ * latency samples are dropped every reset interval, which gives a replica
+ * that was slow a chance to show it recovered.
+ *
+ * Replica ordering by latency and the speculative retry delays derived
+ * from it also go through here, so they are all off while it is disabled.
+ *
+ * One instance per shard, fed by storage_proxy.
+ */
+class dynamic_snitch {
+public:
+    using inet_address = gms::inet_address;
+    using duration = utils::latency_estimator::duration;
+    struct config {
+        bool enabled = false;
+        std::chrono::milliseconds update_interval = std::chrono::milliseconds(100);
+        // Zero disables resetting.
+        std::chrono::milliseconds reset_interval = std::chrono::milliseconds(60000);
+        double badness_threshold = 0.1;
+    };
+private:
+    // How much a fully hot cache lowers a replica's score.
+    static constexpr double cache_hit_rate_weight = 0.5;
+    // Latency samples older than this are considered stale.
+    static constexpr auto latency_max_age = std::chrono::seconds(10);
+
+    struct endpoint_stats {
+        utils::latency_estimator latency;
+        unsigned pending = 0;
+        float hit_rate = 0;
+    };
+    config _cfg;
+    std::unordered_map<inet_address, endpoint_stats> _stats;
+    std::unordered_map<inet_address, double> _scores;
+    timer<lowres_clock> _update_timer;
+    timer<lowres_clock> _reset_timer;
+private:
+    double score(inet_address ep) const;
+public:
+    explicit dynamic_snitch(config cfg);
+
+    // Called around each read request sent to a replica.
+    void request_started(inet_address ep);
+    void request_completed(inet_address ep, duration latency);
+    // Records the hit rate of the replica's cache, ignores invalid ones.
+    void record_cache_hit_rate(inet_address ep, float hit_rate);
+
+    // Recent latency of the replica, disengaged if there are no fresh samples.
+    stdx::optional<duration> latency_mean(inet_address ep) const;
+    stdx::optional<duration> latency_high_estimate(inet_address ep) const;
+
+    // Reorders replicas sorted by the snitch's proximity within each of their
+    // datacenters, according to their scores.
+    void sort_by_score(std::vector<inet_address>& addresses) const;
+
+    // Orders the replicas a read contacts up front by their recent latency.
+    // If has_extra_replica, the last one is only contacted when speculating.
+    void order_by_latency(std::vector<inet_address>& targets, bool has_extra_replica) const;
+
+    // Returns how long to wait for the replicas in [begin, end) before
+    // speculating, if their recent latency says it should be shorter than
+    // the table-wide delay.
+    template<typename Iterator>
+    stdx::optional<std::chrono::milliseconds> speculation_delay(Iterator begin, Iterator end, std::chrono::milliseconds table_delay) const {
+        if (begin == end) {
+            return stdx::nullopt;
+        }
+        duration replicas = duration::zero();
+        for (auto it = begin; it != end; ++it) {
+            auto estimate = latency_high_estimate(*it);
+            if (!estimate) {
+                return stdx::nullopt;
+            }
+            replicas = std::max(replicas, *estimate);
+        }
+        if (replicas >= table_delay) {
+            return stdx::nullopt;
+        }
+        return std::max(std::chrono::duration_cast<std::chrono::milliseconds>(replicas), std::chrono::milliseconds(1));
+    }
+
+    void update_scores();
+    void reset();
+
+    const std::unordered_map<inet_address, double>& scores() const {
+        return _scores;
+    }
+};
+
+}
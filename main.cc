@@ -41,6 +41,7 @@
 #include "db/hints/manager.hh"
 #include "db/commitlog/commitlog_replayer.hh"
 #include "db/view/view_builder.hh"
+#include "db/cache_warmer.hh"
 #include "utils/runtime.hh"
 #include "utils/file_lock.hh"
 #include "log.hh"
@@ -365,6 +366,9 @@ int main(int ac, char** av) {
 
             logalloc::prime_segment_pool(memory::stats().total_memory(), memory::min_free_memory()).get();
             logging::apply_settings(cfg->logging_settings(opts));
+            if (cfg->lsa_huge_pages()) {
+                logalloc::advise_huge_pages().get();
+            }
 
             verify_rlimit(cfg->developer_mode());
             verify_adequate_memory_per_shard(cfg->developer_mode());
@@ -537,6 +541,11 @@ int main(int ac, char** av) {
             directories.insert(db.local().get_config().data_file_directories().cbegin(),
                     db.local().get_config().data_file_directories().cend());
             directories.insert(db.local().get_config().commitlog_directory());
+            if (db.local().get_config().row_cache_keys_to_save()) {
+                supervisor::notify("creating saved caches directory");
+                dirs.touch_and_lock(db.local().get_config().saved_caches_directory()).get();
+                directories.insert(db.local().get_config().saved_caches_directory());
+            }
 
             supervisor::notify("creating hints directories");
             if (hinted_handoff_enabled) {
@@ -615,10 +624,18 @@ int main(int ac, char** av) {
                     , cluster_name
                     , phi
                     , cfg->listen_on_broadcast_address());
+            netw::get_messaging_service().invoke_on_all([shard_aware = cfg->internode_shard_aware_connections()] (auto& ms) {
+                ms.set_shard_aware_connections(shard_aware);
+            }).get();
             supervisor::notify("starting storage proxy");
             service::storage_proxy::config spcfg;
             spcfg.hinted_handoff_enabled = hinted_handoff_enabled;
             spcfg.available_memory = memory::stats().total_memory();
+            spcfg.dynamic_snitch.enabled = cfg->dynamic_snitch();
+            spcfg.dynamic_snitch.update_interval = std::chrono::milliseconds(cfg->dynamic_snitch_update_interval_in_ms());
+            spcfg.dynamic_snitch.reset_interval = std::chrono::milliseconds(cfg->dynamic_snitch_reset_interval_in_ms());
+            spcfg.dynamic_snitch.badness_threshold = cfg->dynamic_snitch_badness_threshold();
+            spcfg.write_batch_window = std::chrono::microseconds(cfg->write_batch_window_in_us());
             proxy.start(std::ref(db), spcfg).get();
             // #293 - do not stop anything
             // engine().at_exit([&proxy] { return proxy.stop(); });
@@ -769,6 +786,19 @@ int main(int ac, char** av) {
             engine().at_exit([&cf_cache_hitrate_calculator] { return cf_cache_hitrate_calculator.stop(); });
             cf_cache_hitrate_calculator.local().run_on(engine().cpu_id());
             api::set_server_cache(ctx);
+            static sharded<db::cache_warmer> cache_warmer;
+            if (cfg->row_cache_keys_to_save()) {
+                supervisor::notify("starting cache warmer");
+                db::cache_warmer::config cwcfg;
+                cwcfg.directory = cfg->saved_caches_directory();
+                cwcfg.save_period = std::chrono::seconds(cfg->row_cache_save_period());
+                cwcfg.keys_to_save = cfg->row_cache_keys_to_save();
+                cwcfg.warmup_bandwidth = size_t(cfg->row_cache_warmup_bandwidth_mb_per_sec()) << 20;
+                cwcfg.scheduling_group = maintenance_scheduling_group;
+                cache_warmer.start(std::ref(db), cwcfg).get();
+                engine().at_exit([] { return cache_warmer.stop(); });
+                cache_warmer.invoke_on_all(&db::cache_warmer::start).get();
+            }
             gms::get_local_gossiper().wait_for_gossip_to_settle().get();
             api::set_server_gossip_settle(ctx).get();
 
@@ -785,7 +815,8 @@ int main(int ac, char** av) {
             static sharded<db::view::view_builder> view_builder;
             if (cfg->view_building()) {
                 supervisor::notify("starting the view builder");
-                view_builder.start(std::ref(db), std::ref(sys_dist_ks), std::ref(mm)).get();
+                auto view_building_scheduling_group = make_sched_group("view_building", cfg->view_building_shares());
+                view_builder.start(std::ref(db), std::ref(sys_dist_ks), std::ref(mm), view_building_scheduling_group).get();
                 view_builder.invoke_on_all(&db::view::view_builder::start).get();
             }
 
@@ -808,6 +839,17 @@ int main(int ac, char** av) {
             smp::invoke_on_all([&cfg] () {
                 return logalloc::shard_tracker().set_reclamation_step(cfg->lsa_reclamation_step());
             }).get();
+            if (cfg->lsa_background_reclaim_free_segments()) {
+                auto background_reclaim_scheduling_group = make_sched_group("background_reclaim", 200);
+                smp::invoke_on_all([&cfg, background_reclaim_scheduling_group] () {
+                    logalloc::shard_tracker().start_background_reclaim(background_reclaim_scheduling_group, cfg->lsa_background_reclaim_free_segments());
+                }).get();
+                engine().at_exit([] {
+                    return smp::invoke_on_all([] {
+                        return logalloc::shard_tracker().stop_background_reclaim();
+                    });
+                });
+            }
             if (cfg->abort_on_lsa_bad_alloc()) {
                 smp::invoke_on_all([&cfg]() {
                     return logalloc::shard_tracker().enable_abort_on_bad_alloc();
@@ -46,3 +46,17 @@ future<>
 write_memtable_to_sstable(memtable& mt,
         sstables::shared_sstable sst,
         db::large_partition_handler* lp_handler);
+
+// Writes the part of the memtable which falls into the given range, as one
+// member of the sstable run identified by run_identifier. The range must be
+// kept alive until the returned future resolves.
+future<>
+write_memtable_to_sstable(memtable& mt,
+        sstables::shared_sstable sst,
+        const dht::partition_range& range,
+        uint64_t estimated_partitions,
+        utils::UUID run_identifier,
+        sstables::write_monitor& mon,
+        db::large_partition_handler* lp_handler,
+        bool backup,
+        const io_priority_class& pc);
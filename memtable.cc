@@ -26,6 +26,7 @@
 #include "partition_snapshot_reader.hh"
 #include "schema_upgrader.hh"
 #include "partition_builder.hh"
+#include "mutation_partition_applier.hh"
 
 memtable::memtable(schema_ptr schema, dirty_memory_manager& dmm, memtable_list* memtable_list,
     seastar::scheduling_group compaction_scheduling_group)
@@ -470,9 +471,9 @@ class flush_reader final : public flat_mutation_reader::impl, private iterator_r
     flat_mutation_reader_opt _partition_reader;
     flush_memory_accounter _flushed_memory;
 public:
-    flush_reader(schema_ptr s, lw_shared_ptr<memtable> m)
+    flush_reader(schema_ptr s, lw_shared_ptr<memtable> m, const dht::partition_range& range)
         : impl(s)
-        , iterator_reader(std::move(s), m, query::full_partition_range)
+        , iterator_reader(std::move(s), m, range)
         , _flushed_memory(*m)
     {}
     flush_reader(const flush_reader&) = delete;
@@ -598,16 +599,55 @@ memtable::make_flat_reader(schema_ptr s,
 }
 
 flat_mutation_reader
-memtable::make_flush_reader(schema_ptr s, const io_priority_class& pc) {
+memtable::make_flush_reader(schema_ptr s, const io_priority_class& pc, const dht::partition_range& range) {
     if (group()) {
-        return make_flat_mutation_reader<flush_reader>(s, shared_from_this());
+        return make_flat_mutation_reader<flush_reader>(s, shared_from_this(), range);
     } else {
         auto& full_slice = s->full_slice();
         return make_flat_mutation_reader<scanning_reader>(std::move(s), shared_from_this(),
-            query::full_partition_range, full_slice, pc, mutation_reader::forwarding::no);
+            range, full_slice, pc, mutation_reader::forwarding::no);
     }
 }
 
+dht::partition_range_vector
+memtable::split_for_flush(unsigned max_ranges) const {
+    if (max_ranges <= 1 || partitions.size() < max_ranges) {
+        return { query::full_partition_range };
+    }
+    std::deque<std::pair<dht::token, dht::token>> pieces;
+    {
+        logalloc::reclaim_lock rl(const_cast<memtable&>(*this));
+        pieces.emplace_back(partitions.begin()->key().token(), partitions.rbegin()->key().token());
+    }
+    // Keys of a shard are spread uniformly over the tokens it owns, so
+    // bisecting the span of this memtable yields pieces of similar size.
+    auto& partitioner = dht::global_partitioner();
+    while (pieces.size() < max_ranges) {
+        auto [left, right] = pieces.front();
+        auto mid = partitioner.midpoint(left, right);
+        if (!(left < mid && mid < right)) {
+            break;
+        }
+        pieces.pop_front();
+        pieces.emplace_back(std::move(left), mid);
+        pieces.emplace_back(mid, std::move(right));
+    }
+    std::sort(pieces.begin(), pieces.end(), [] (auto& a, auto& b) { return a.first < b.first; });
+
+    // The first and last ranges are left open, so that the ranges cover the
+    // whole ring, including partitions added after the split was computed.
+    dht::partition_range_vector ranges;
+    ranges.reserve(pieces.size());
+    stdx::optional<dht::partition_range::bound> start;
+    for (auto it = std::next(pieces.begin()); it != pieces.end(); ++it) {
+        auto split = dht::ring_position::starting_at(it->first);
+        ranges.emplace_back(std::move(start), dht::partition_range::bound(split, false));
+        start = dht::partition_range::bound(std::move(split), true);
+    }
+    ranges.emplace_back(std::move(start), stdx::nullopt);
+    return ranges;
+}
+
 void
 memtable::update(db::rp_handle&& h) {
     db::replay_position rp = h;
@@ -641,12 +681,73 @@ memtable::apply(const mutation& m, db::rp_handle&& h) {
     update(std::move(h));
 }
 
+// Applies a frozen partition directly into the latest version of a memtable
+// entry, collecting encoding statistics on the way.
+//
+// Unlike partition_entry::apply(), this doesn't provide strong exception
+// guarantees: the target may be left with part of the data applied. This is
+// fine, because applying the same data again, e.g. when the allocating section
+// retries after reserving more memory, yields the same result as applying it once.
+class memtable::in_place_applier final : public mutation_partition_applier {
+    const schema& _schema;
+    encoding_stats_collector& _stats;
+public:
+    in_place_applier(const schema& s, mutation_partition& target, encoding_stats_collector& stats)
+        : mutation_partition_applier(s, target)
+        , _schema(s)
+        , _stats(stats)
+    { }
+
+    virtual void accept_partition_tombstone(tombstone t) override {
+        _stats.update(t);
+        mutation_partition_applier::accept_partition_tombstone(t);
+    }
+
+    virtual void accept_static_cell(column_id id, atomic_cell_view cell) override {
+        _stats.update(cell);
+        mutation_partition_applier::accept_static_cell(id, cell);
+    }
+
+    virtual void accept_static_cell(column_id id, collection_mutation_view collection) override {
+        _stats.update(_schema.static_column_at(id), collection);
+        mutation_partition_applier::accept_static_cell(id, collection);
+    }
+
+    virtual void accept_row_tombstone(const range_tombstone& rt) override {
+        _stats.update(rt);
+        mutation_partition_applier::accept_row_tombstone(rt);
+    }
+
+    virtual void accept_row(position_in_partition_view key, const row_tombstone& deleted_at, const row_marker& rm, is_dummy dummy, is_continuous continuous) override {
+        _stats.update(rm);
+        _stats.update(deleted_at.regular());
+        _stats.update(deleted_at.tomb());
+        mutation_partition_applier::accept_row(key, deleted_at, rm, dummy, continuous);
+    }
+
+    virtual void accept_row_cell(column_id id, atomic_cell_view cell) override {
+        _stats.update(cell);
+        mutation_partition_applier::accept_row_cell(id, cell);
+    }
+
+    virtual void accept_row_cell(column_id id, collection_mutation_view collection) override {
+        _stats.update(_schema.regular_column_at(id), collection);
+        mutation_partition_applier::accept_row_cell(id, collection);
+    }
+};
+
 void
 memtable::apply(const frozen_mutation& m, const schema_ptr& m_schema, db::rp_handle&& h) {
     with_allocator(allocator(), [this, &m, &m_schema] {
         _allocating_section(*this, [&, this] {
           with_linearized_managed_bytes([&] {
             auto& p = find_or_create_partition_slow(m.key(*_schema));
+            auto* target = m_schema->version() == _schema->version() ? p.partition_for_in_place_update() : nullptr;
+            if (target) {
+                in_place_applier applier(*_schema, *target, _stats_collector);
+                m.partition().accept(*_schema, applier);
+                return;
+            }
             mutation_partition mp(m_schema);
             partition_builder pb(*m_schema, mp);
             m.partition().accept(*m_schema, pb);
@@ -178,20 +178,24 @@ class memtable final : public enable_lw_shared_from_this<memtable>, private loga
             }
         }
 
+        void update(const column_definition& col, collection_mutation_view cmv) {
+            auto ctype = static_pointer_cast<const collection_type_impl>(col.type);
+          cmv.data.with_linearized([&] (bytes_view bv) {
+            auto mview = ctype->deserialize_mutation_form(bv);
+            update(mview.tomb);
+            for (auto& entry : mview.cells) {
+                update(entry.second);
+            }
+          });
+        }
+
         void update(const schema& s, const row& r, column_kind kind) {
             r.for_each_cell([this, &s, kind](column_id id, const atomic_cell_or_collection& item) {
                 auto& col = s.column_at(kind, id);
                 if (col.is_atomic()) {
                     update(item.as_atomic_cell(col));
                 } else {
-                    auto ctype = static_pointer_cast<const collection_type_impl>(col.type);
-                  item.as_collection_mutation().data.with_linearized([&] (bytes_view bv) {
-                    auto mview = ctype->deserialize_mutation_form(bv);
-                    update(mview.tomb);
-                    for (auto& entry : mview.cells) {
-                        update(entry.second);
-                    }
-                  });
+                    update(col, item.as_collection_mutation());
                 }
             });
         }
@@ -240,6 +244,8 @@ class memtable final : public enable_lw_shared_from_this<memtable>, private loga
         }
     } _stats_collector;
 
+    class in_place_applier;
+
     void update(db::rp_handle&&);
     friend class row_cache;
     friend class memtable_entry;
@@ -328,7 +334,15 @@ class memtable final : public enable_lw_shared_from_this<memtable>, private loga
         return make_flat_reader(s, range, full_slice);
     }
 
-    flat_mutation_reader make_flush_reader(schema_ptr, const io_priority_class& pc);
+    // The 'range' parameter must be live as long as the reader is being used.
+    flat_mutation_reader make_flush_reader(schema_ptr, const io_priority_class& pc,
+                                           const dht::partition_range& range = query::full_partition_range);
+
+    // Splits the ring into at most max_ranges disjoint partition ranges, each
+    // holding a similar share of this memtable's partitions, so that they can
+    // be flushed by concurrent writers. Returns a single full range if the
+    // memtable is too small to be worth splitting.
+    dht::partition_range_vector split_for_flush(unsigned max_ranges) const;
 
     mutation_source as_data_source();
 
@@ -25,6 +25,7 @@
 #include "gms/gossiper.hh"
 #include "service/storage_service.hh"
 #include "streaming/prepare_message.hh"
+#include "message/mutation_batch.hh"
 #include "gms/gossip_digest_syn.hh"
 #include "gms/gossip_digest_ack.hh"
 #include "gms/gossip_digest_ack2.hh"
@@ -32,9 +33,12 @@
 #include "query-request.hh"
 #include "query-result.hh"
 #include <seastar/rpc/rpc.hh>
+#include <seastar/core/posix.hh>
+#include <seastar/net/socket_defs.hh>
 #include "db/config.hh"
 #include "db/system_keyspace.hh"
 #include "dht/i_partitioner.hh"
+#include "utils/class_registrator.hh"
 #include "range.hh"
 #include "frozen_schema.hh"
 #include "repair/repair.hh"
@@ -56,6 +60,8 @@
 #include "idl/partition_checksum.dist.hh"
 #include "idl/query.dist.hh"
 #include "idl/cache_temperature.dist.hh"
+#include "idl/view.dist.hh"
+#include "idl/mutation_batch.dist.hh"
 #include "serializer_impl.hh"
 #include "serialization_visitors.hh"
 #include "idl/consistency_level.dist.impl.hh"
@@ -75,12 +81,15 @@
 #include "idl/partition_checksum.dist.impl.hh"
 #include "idl/query.dist.impl.hh"
 #include "idl/cache_temperature.dist.impl.hh"
+#include "idl/view.dist.impl.hh"
+#include "idl/mutation_batch.dist.impl.hh"
 #include <seastar/rpc/lz4_compressor.hh>
 #include <seastar/rpc/multi_algo_compressor_factory.hh>
 #include "partition_range_compat.hh"
 #include "stdx.hh"
 #include <boost/range/adaptor/filtered.hpp>
 #include <boost/range/adaptor/indirected.hpp>
+#include <random>
 #include "frozen_mutation.hh"
 #include "flat_mutation_reader.hh"
 #include "streaming/stream_manager.hh"
@@ -194,6 +203,14 @@ size_t msg_addr::hash::operator()(const msg_addr& id) const {
     return std::hash<uint32_t>()(id.addr.raw_addr());
 }
 
+size_t msg_addr::shard_hash::operator()(const msg_addr& id) const {
+    return std::hash<uint64_t>()((uint64_t(id.addr.raw_addr()) << 32) | id.cpu_id);
+}
+
+bool msg_addr::shard_equal::operator()(const msg_addr& x, const msg_addr& y) const {
+    return x.addr == y.addr && x.cpu_id == y.cpu_id;
+}
+
 messaging_service::shard_info::shard_info(shared_ptr<rpc_protocol_client_wrapper>&& client)
     : rpc_client(std::move(client)) {
 }
@@ -417,6 +434,7 @@ static constexpr unsigned do_get_rpc_client_idx(messaging_verb verb) {
     switch (verb) {
     case messaging_verb::CLIENT_ID:
     case messaging_verb::MUTATION:
+    case messaging_verb::MUTATION_BATCH:
     case messaging_verb::READ_DATA:
     case messaging_verb::READ_MUTATION_DATA:
     case messaging_verb::READ_DIGEST:
@@ -526,8 +544,42 @@ void messaging_service::cache_preferred_ip(gms::inet_address ep, gms::inet_addre
     _preferred_ip_cache[ep] = ip;
 }
 
+uint16_t messaging_service::pick_shard_aware_port(unsigned shard, unsigned shard_count) {
+    static thread_local std::default_random_engine random_engine{std::random_device{}()};
+    unsigned low = shard_aware_port_low;
+    unsigned high = shard_aware_port_high;
+    std::uniform_int_distribution<unsigned> dist((low + shard_count - 1) / shard_count, (high - shard) / shard_count);
+    return dist(random_engine) * shard_count + shard;
+}
+
+// Returns a local address with a source port that the peer accepts on the
+// given shard. Tries a few ports, skipping the ones that cannot be bound
+// right now, and falls back to an ephemeral port, which reaches any shard.
+static ipv4_addr shard_aware_local_addr(unsigned shard, unsigned shard_count) {
+    static constexpr int max_attempts = 4;
+    for (int attempt = 0; attempt < max_attempts; ++attempt) {
+        auto port = messaging_service::pick_shard_aware_port(shard, shard_count);
+        try {
+            auto fd = file_desc::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            socket_address sa(ipv4_addr(port));
+            fd.bind(sa.as_posix_sockaddr(), sizeof(::sockaddr_in));
+            return ipv4_addr(port);
+        } catch (std::system_error& e) {
+            mlogger.debug("Cannot bind source port {} for shard {}: {}", port, shard, e.what());
+        }
+    }
+    mlogger.debug("No free source port found for shard {}, using an ephemeral one", shard);
+    return ipv4_addr();
+}
+
+msg_addr messaging_service::client_key(msg_addr id) const {
+    // Without shard-aware connections, all shards of a peer share a connection.
+    return _shard_aware_connections ? id : msg_addr{id.addr, 0};
+}
+
 shared_ptr<messaging_service::rpc_protocol_client_wrapper> messaging_service::get_rpc_client(messaging_verb verb, msg_addr id) {
     assert(!_stopping);
+    id = client_key(id);
     auto idx = get_rpc_client_idx(verb);
     auto it = _clients[idx].find(id);
 
@@ -585,6 +637,17 @@ shared_ptr<messaging_service::rpc_protocol_client_wrapper> messaging_service::ge
 
     auto remote_addr = ipv4_addr(get_preferred_ip(id.addr).raw_addr(), must_encrypt ? _ssl_port : _port);
 
+    // The peer accepts each connection on the shard given by its source port
+    // modulo the peer's shard count (see start_listen()), so choose the source
+    // port to reach the requested shard.
+    auto local_addr = ipv4_addr();
+    if (_shard_aware_connections) {
+        auto it = _peer_partitioners.find(id.addr);
+        if (it != _peer_partitioners.end() && id.cpu_id < it->second->shard_count()) {
+            local_addr = shard_aware_local_addr(id.cpu_id, it->second->shard_count());
+        }
+    }
+
     rpc::client_options opts;
     // send keepalive messages each minute if connection is idle, drop connection after 10 failures
     opts.keepalive = std::experimental::optional<net::tcp_keepalive_params>({60s, 60s, 10});
@@ -595,9 +658,9 @@ shared_ptr<messaging_service::rpc_protocol_client_wrapper> messaging_service::ge
 
     auto client = must_encrypt ?
                     ::make_shared<rpc_protocol_client_wrapper>(*_rpc, std::move(opts),
-                                    remote_addr, ipv4_addr(), _credentials) :
+                                    remote_addr, local_addr, _credentials) :
                     ::make_shared<rpc_protocol_client_wrapper>(*_rpc, std::move(opts),
-                                    remote_addr);
+                                    remote_addr, local_addr);
 
     it = _clients[idx].emplace(id, shard_info(std::move(client))).first;
     uint32_t src_cpu_id = engine().cpu_id();
@@ -634,7 +697,7 @@ bool messaging_service::remove_rpc_client_one(clients_map& clients, msg_addr id,
 }
 
 void messaging_service::remove_error_rpc_client(messaging_verb verb, msg_addr id) {
-    if (remove_rpc_client_one(_clients[get_rpc_client_idx(verb)], id, true)) {
+    if (remove_rpc_client_one(_clients[get_rpc_client_idx(verb)], client_key(id), true)) {
         for (auto&& cb : _connection_drop_notifiers) {
             cb(id.addr);
         }
@@ -643,8 +706,35 @@ void messaging_service::remove_error_rpc_client(messaging_verb verb, msg_addr id
 
 void messaging_service::remove_rpc_client(msg_addr id) {
     for (auto& c : _clients) {
-        remove_rpc_client_one(c, id, false);
+        std::vector<msg_addr> ids;
+        for (auto&& e : c) {
+            if (e.first.addr == id.addr) {
+                ids.push_back(e.first);
+            }
+        }
+        for (auto&& i : ids) {
+            remove_rpc_client_one(c, i, false);
+        }
+    }
+}
+
+void messaging_service::set_peer_sharding(gms::inet_address ep, unsigned shard_count, unsigned sharding_ignore_msb) {
+    auto& p = _peer_partitioners[ep];
+    if (!p || p->shard_count() != shard_count || p->sharding_ignore_msb() != sharding_ignore_msb) {
+        p = create_object<dht::i_partitioner, const unsigned&, const unsigned&>(dht::global_partitioner().name(), shard_count, sharding_ignore_msb);
+    }
+}
+
+void messaging_service::remove_peer_sharding(gms::inet_address ep) {
+    _peer_partitioners.erase(ep);
+}
+
+unsigned messaging_service::shard_of(gms::inet_address ep, const dht::token& t) const {
+    if (!_shard_aware_connections) {
+        return 0;
     }
+    auto it = _peer_partitioners.find(ep);
+    return it != _peer_partitioners.end() ? it->second->shard_of(t) : 0;
 }
 
 std::unique_ptr<messaging_service::rpc_protocol_wrapper>& messaging_service::rpc() {
@@ -882,6 +972,17 @@ future<> messaging_service::send_mutation(msg_addr id, clock_type::time_point ti
         std::move(reply_to), std::move(shard), std::move(response_id), std::move(trace_info));
 }
 
+void messaging_service::register_mutation_batch(std::function<future<rpc::no_wait_type> (const rpc::client_info&, rpc::opt_time_point, inet_address reply_to,
+    std::vector<mutation_batch_entry> entries)>&& func) {
+    register_handler(this, netw::messaging_verb::MUTATION_BATCH, std::move(func));
+}
+void messaging_service::unregister_mutation_batch() {
+    _rpc->unregister_handler(netw::messaging_verb::MUTATION_BATCH);
+}
+future<> messaging_service::send_mutation_batch(msg_addr id, clock_type::time_point timeout, inet_address reply_to, std::vector<mutation_batch_entry> entries) {
+    return send_message_oneway_timeout(this, timeout, messaging_verb::MUTATION_BATCH, std::move(id), std::move(reply_to), std::move(entries));
+}
+
 void messaging_service::register_counter_mutation(std::function<future<> (const rpc::client_info&, rpc::opt_time_point, std::vector<frozen_mutation> fms, db::consistency_level cl, stdx::optional<tracing::trace_info> trace_info)>&& func) {
     register_handler(this, netw::messaging_verb::COUNTER_MUTATION, std::move(func));
 }
@@ -892,14 +993,14 @@ future<> messaging_service::send_counter_mutation(msg_addr id, clock_type::time_
     return send_message_timeout<void>(this, messaging_verb::COUNTER_MUTATION, std::move(id), timeout, std::move(fms), cl, std::move(trace_info));
 }
 
-void messaging_service::register_mutation_done(std::function<future<rpc::no_wait_type> (const rpc::client_info& cinfo, unsigned shard, response_id_type response_id)>&& func) {
+void messaging_service::register_mutation_done(std::function<future<rpc::no_wait_type> (const rpc::client_info& cinfo, unsigned shard, response_id_type response_id, rpc::optional<db::view::update_backlog> backlog)>&& func) {
     register_handler(this, netw::messaging_verb::MUTATION_DONE, std::move(func));
 }
 void messaging_service::unregister_mutation_done() {
     _rpc->unregister_handler(netw::messaging_verb::MUTATION_DONE);
 }
-future<> messaging_service::send_mutation_done(msg_addr id, unsigned shard, response_id_type response_id) {
-    return send_message_oneway(this, messaging_verb::MUTATION_DONE, std::move(id), std::move(shard), std::move(response_id));
+future<> messaging_service::send_mutation_done(msg_addr id, unsigned shard, response_id_type response_id, db::view::update_backlog backlog) {
+    return send_message_oneway(this, messaging_verb::MUTATION_DONE, std::move(id), std::move(shard), std::move(response_id), std::move(backlog));
 }
 
 void messaging_service::register_mutation_failed(std::function<future<rpc::no_wait_type> (const rpc::client_info& cinfo, unsigned shard, response_id_type response_id, size_t num_failed)>&& func) {
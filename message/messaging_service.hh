@@ -36,6 +36,7 @@
 #include "tracing/tracing.hh"
 #include "digest_algorithm.hh"
 #include "streaming/stream_reason.hh"
+#include "db/view/view_update_backlog.hh"
 
 #include <seastar/net/tls.hh>
 
@@ -112,7 +113,8 @@ enum class messaging_verb : int32_t {
     COUNTER_MUTATION = 23,
     MUTATION_FAILED = 24,
     STREAM_MUTATION_FRAGMENTS = 25,
-    LAST = 26,
+    MUTATION_BATCH = 26,
+    LAST = 27,
 };
 
 } // namespace netw
@@ -141,7 +143,9 @@ class messaging_service : public seastar::async_sharded_service<messaging_servic
     using msg_addr = netw::msg_addr;
     using inet_address = gms::inet_address;
     using UUID = utils::UUID;
-    using clients_map = std::unordered_map<msg_addr, shard_info, msg_addr::hash>;
+    // Keyed by client_key(), with a connection per shard of the peer when
+    // shard-aware connections are enabled.
+    using clients_map = std::unordered_map<msg_addr, shard_info, msg_addr::shard_hash, msg_addr::shard_equal>;
 
     // This should change only if serialization format changes
     static constexpr int32_t current_version = 0;
@@ -212,6 +216,9 @@ class messaging_service : public seastar::async_sharded_service<messaging_servic
     std::list<std::function<void(gms::inet_address ep)>> _connection_drop_notifiers;
     memory_config _mcfg;
     scheduling_config _scheduling_config;
+    bool _shard_aware_connections = false;
+    // map: Node broadcast address -> partitioner with the node's sharding, as gossiped by it
+    std::unordered_map<gms::inet_address, std::unique_ptr<dht::i_partitioner>> _peer_partitioners;
 public:
     using clock_type = lowres_clock;
 public:
@@ -236,6 +243,28 @@ class messaging_service : public seastar::async_sharded_service<messaging_servic
     future<> init_local_preferred_ip_cache();
     void cache_preferred_ip(gms::inet_address ep, gms::inet_address ip);
 
+    // When enabled, a connection to msg_addr{ep, shard} is accepted by that
+    // shard of ep, so that ep handles requests sent over it without moving
+    // them to another shard first. Needs the sharding of ep, see set_peer_sharding().
+    void set_shard_aware_connections(bool enabled) {
+        _shard_aware_connections = enabled;
+    }
+    bool shard_aware_connections() const {
+        return _shard_aware_connections;
+    }
+    void set_peer_sharding(gms::inet_address ep, unsigned shard_count, unsigned sharding_ignore_msb);
+    void remove_peer_sharding(gms::inet_address ep);
+    // The shard of ep to send requests about t to: the one owning t if
+    // connections are shard-aware and the sharding of ep is known, 0 otherwise.
+    unsigned shard_of(gms::inet_address ep, const dht::token& t) const;
+
+    // The default Linux ephemeral port range, which shard-aware connections bind their source ports in.
+    static constexpr uint16_t shard_aware_port_low = 32768;
+    static constexpr uint16_t shard_aware_port_high = 60999;
+    // Picks a random port in the range above that a peer with shard_count
+    // shards accepts on the given shard.
+    static uint16_t pick_shard_aware_port(unsigned shard, unsigned shard_count);
+
     // Wrapper for PREPARE_MESSAGE verb
     void register_prepare_message(std::function<future<streaming::prepare_message> (const rpc::client_info& cinfo,
             streaming::prepare_message msg, UUID plan_id, sstring description, rpc::optional<streaming::stream_reason> reason)>&& func);
@@ -311,15 +340,21 @@ class messaging_service : public seastar::async_sharded_service<messaging_servic
     future<> send_mutation(msg_addr id, clock_type::time_point timeout, const frozen_mutation& fm, std::vector<inet_address> forward,
         inet_address reply_to, unsigned shard, response_id_type response_id, std::experimental::optional<tracing::trace_info> trace_info = std::experimental::nullopt);
 
+    // Wrapper for MUTATION_BATCH
+    void register_mutation_batch(std::function<future<rpc::no_wait_type> (const rpc::client_info&, rpc::opt_time_point, inet_address reply_to,
+        std::vector<mutation_batch_entry> entries)>&& func);
+    void unregister_mutation_batch();
+    future<> send_mutation_batch(msg_addr id, clock_type::time_point timeout, inet_address reply_to, std::vector<mutation_batch_entry> entries);
+
     // Wrapper for COUNTER_MUTATION
     void register_counter_mutation(std::function<future<> (const rpc::client_info&, rpc::opt_time_point, std::vector<frozen_mutation> fms, db::consistency_level cl, stdx::optional<tracing::trace_info> trace_info)>&& func);
     void unregister_counter_mutation();
     future<> send_counter_mutation(msg_addr id, clock_type::time_point timeout, std::vector<frozen_mutation> fms, db::consistency_level cl, stdx::optional<tracing::trace_info> trace_info = std::experimental::nullopt);
 
     // Wrapper for MUTATION_DONE
-    void register_mutation_done(std::function<future<rpc::no_wait_type> (const rpc::client_info& cinfo, unsigned shard, response_id_type response_id)>&& func);
+    void register_mutation_done(std::function<future<rpc::no_wait_type> (const rpc::client_info& cinfo, unsigned shard, response_id_type response_id, rpc::optional<db::view::update_backlog> backlog)>&& func);
     void unregister_mutation_done();
-    future<> send_mutation_done(msg_addr id, unsigned shard, response_id_type response_id);
+    future<> send_mutation_done(msg_addr id, unsigned shard, response_id_type response_id, db::view::update_backlog backlog);
 
     // Wrapper for MUTATION_FAILED
     void register_mutation_failed(std::function<future<rpc::no_wait_type> (const rpc::client_info& cinfo, unsigned shard, response_id_type response_id, size_t num_failed)>&& func);
@@ -364,10 +399,12 @@ class messaging_service : public seastar::async_sharded_service<messaging_servic
     void foreach_server_connection_stats(std::function<void(const rpc::client_info&, const rpc::stats&)>&& f) const;
 private:
     bool remove_rpc_client_one(clients_map& clients, msg_addr id, bool dead_only);
+    msg_addr client_key(msg_addr id) const;
 public:
     // Return rpc::protocol::client for a shard which is a ip + cpuid pair.
     shared_ptr<rpc_protocol_client_wrapper> get_rpc_client(messaging_verb verb, msg_addr id);
     void remove_error_rpc_client(messaging_verb verb, msg_addr id);
+    // Drops the connections to all shards of id.addr.
     void remove_rpc_client(msg_addr id);
     using drop_notifier_handler = decltype(_connection_drop_notifiers)::iterator;
     drop_notifier_handler register_connection_drop_notifier(std::function<void(gms::inet_address ep)> cb);
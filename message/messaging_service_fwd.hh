@@ -26,6 +26,7 @@ namespace netw {
 struct msg_addr;
 enum class messaging_verb;
 class messaging_service;
+struct mutation_batch_entry;
 
 messaging_service& get_local_messaging_service();
 
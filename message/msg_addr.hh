@@ -35,6 +35,14 @@ struct msg_addr {
     struct hash {
         size_t operator()(const msg_addr& id) const;
     };
+    // The comparisons above ignore cpu_id. These tell the shards of a node
+    // apart, for state kept per shard of a peer.
+    struct shard_hash {
+        size_t operator()(const msg_addr& id) const;
+    };
+    struct shard_equal {
+        bool operator()(const msg_addr& x, const msg_addr& y) const;
+    };
 };
 
 }
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2018 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "message/mutation_batch.hh"
+
+namespace netw {
+
+mutation_batcher::mutation_batcher(std::chrono::microseconds window, size_t max_batch_size, send_func send)
+    : _window(window)
+    , _max_batch_size(max_batch_size)
+    , _send(std::move(send))
+    , _timer([this] { flush_all(); })
+{}
+
+future<> mutation_batcher::add(msg_addr ep, clock_type::time_point timeout, mutation_batch_entry entry) {
+    auto& batch = _pending[ep];
+    // The replica applies all mutations of a batch with the same timeout, so
+    // use the latest one; the response handlers still time out on their own.
+    batch.timeout = std::max(batch.timeout, timeout);
+    batch.bytes += entry.fm.representation().size();
+    batch.entries.push_back(std::move(entry));
+    batch.sent.emplace_back();
+    auto f = batch.sent.back().get_future();
+    if (batch.bytes >= _max_batch_size) {
+        flush(ep);
+    } else if (!_timer.armed()) {
+        _timer.arm(_window);
+    }
+    return f;
+}
+
+void mutation_batcher::flush(msg_addr ep) {
+    auto it = _pending.find(ep);
+    if (it == _pending.end()) {
+        return;
+    }
+    auto batch = std::move(it->second);
+    _pending.erase(it);
+    ++_stats.batches_sent;
+    _stats.batched_mutations += batch.entries.size();
+    (void)futurize_apply(_send, ep, batch.timeout, std::move(batch.entries)).then_wrapped([sent = std::move(batch.sent)] (future<> f) mutable {
+        if (f.failed()) {
+            auto ex = f.get_exception();
+            for (auto& p : sent) {
+                p.set_exception(ex);
+            }
+        } else {
+            for (auto& p : sent) {
+                p.set_value();
+            }
+        }
+    });
+}
+
+void mutation_batcher::flush_all() {
+    while (!_pending.empty()) {
+        flush(_pending.begin()->first);
+    }
+}
+
+void mutation_batcher::stop(std::exception_ptr ex) {
+    _stopped = true;
+    _timer.cancel();
+    for (auto& e : _pending) {
+        for (auto& p : e.second.sent) {
+            p.set_exception(ex);
+        }
+    }
+    _pending.clear();
+}
+
+}
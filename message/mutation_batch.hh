@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2018 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+#include <seastar/core/future.hh>
+#include <seastar/core/lowres_clock.hh>
+#include <seastar/core/timer.hh>
+#include <seastar/util/noncopyable_function.hh>
+
+#include "frozen_mutation.hh"
+#include "gms/inet_address.hh"
+#include "message/msg_addr.hh"
+#include "seastarx.hh"
+#include "stdx.hh"
+#include "tracing/tracing.hh"
+
+namespace netw {
+
+/**
+ * One of the mutations a coordinator sends to a replica in a single
+ * MUTATION_BATCH message. The fields have the same meaning as the
+ * arguments of a MUTATION message, and the replica answers each entry
+ * separately, with MUTATION_DONE or MUTATION_FAILED.
+ */
+struct mutation_batch_entry {
+    frozen_mutation fm;
+    std::vector<gms::inet_address> forward;
+    uint32_t shard;
+    uint64_t response_id;
+    stdx::optional<tracing::trace_info> trace_info;
+};
+
+/**
+ * Collects the mutations a coordinator shard sends to each replica shard
+ * over a short window, and sends them in a single MUTATION_BATCH message.
+ *
+ * The entries of a batch keep their own response ids, and the replica
+ * answers each of them separately. The batcher only tells the senders when
+ * the message carrying their entry was sent, or that sending it failed.
+ */
+class mutation_batcher {
+public:
+    using clock_type = seastar::lowres_clock;
+    using send_func = noncopyable_function<future<> (msg_addr, clock_type::time_point, std::vector<mutation_batch_entry>)>;
+    struct stats {
+        uint64_t batches_sent = 0;
+        uint64_t batched_mutations = 0;
+    };
+private:
+    struct pending_batch {
+        std::vector<mutation_batch_entry> entries;
+        std::vector<promise<>> sent;
+        size_t bytes = 0;
+        clock_type::time_point timeout = clock_type::time_point::min();
+    };
+    std::chrono::microseconds _window;
+    // A batch is sent right away once it grows this large.
+    size_t _max_batch_size;
+    send_func _send;
+    std::unordered_map<msg_addr, pending_batch, msg_addr::shard_hash, msg_addr::shard_equal> _pending;
+    timer<> _timer;
+    stats _stats;
+    bool _stopped = false;
+public:
+    // A zero window disables batching.
+    mutation_batcher(std::chrono::microseconds window, size_t max_batch_size, send_func send);
+
+    // False if entries have to be sent on their own.
+    bool enabled() const {
+        return _window.count() && !_stopped;
+    }
+
+    // Queues an entry for the given replica shard. The returned future
+    // resolves once the batch holding it was sent, and fails if that failed.
+    future<> add(msg_addr ep, clock_type::time_point timeout, mutation_batch_entry entry);
+
+    void flush(msg_addr ep);
+    void flush_all();
+
+    // Fails the pending entries with the given exception, and disables batching.
+    void stop(std::exception_ptr ex);
+
+    const stats& get_stats() const {
+        return _stats;
+    }
+};
+
+}
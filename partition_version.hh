@@ -496,6 +496,14 @@ class partition_entry {
         return _version->all_elements_reversed();
     }
 
+    // Returns the partition of the latest version if no snapshot refers to it,
+    // in which case writes can be applied to it directly, bypassing versioning.
+    // Returns nullptr otherwise.
+    // Use only on non-evictable entries.
+    mutation_partition* partition_for_in_place_update() noexcept {
+        return _snapshot ? nullptr : &_version->partition();
+    }
+
     // Strong exception guarantees.
     // Assumes this instance and mp are fully continuous.
     // Use only on non-evictable entries.
@@ -159,6 +159,53 @@ void cache_tracker::touch(rows_entry& e) {
     _lru.push_front(e);
 }
 
+std::vector<cache_tracker::hot_partition> cache_tracker::hot_partitions(size_t max_partitions, size_t max_rows_scanned) {
+    struct candidate {
+        const cache_entry* entry;
+        uint64_t hits;
+        size_t first_seen;
+    };
+    std::vector<candidate> candidates;
+    std::unordered_map<const cache_entry*, size_t> index;
+    std::vector<hot_partition> result;
+
+    // Pointers into the region are only valid as long as it's not compacted or evicted from.
+    logalloc::reclaim_lock rl(_region);
+    size_t pos = 0;
+    for (rows_entry& row : _lru) {
+        if (pos == max_rows_scanned) {
+            break;
+        }
+        auto& rows = mutation_partition::rows_type::container_of(row);
+        partition_version* pv = &partition_version::container_of(mutation_partition::container_of(rows));
+        while (pv->prev()) {
+            pv = pv->prev();
+        }
+        if (pv->is_referenced_from_entry()) {
+            const cache_entry& ce = cache_entry::container_of(partition_entry::container_of(*pv));
+            auto it = index.find(&ce);
+            if (it == index.end()) {
+                index.emplace(&ce, candidates.size());
+                candidates.push_back(candidate{&ce, 1, pos});
+            } else {
+                ++candidates[it->second].hits;
+            }
+        }
+        ++pos;
+    }
+
+    auto n = std::min(max_partitions, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + n, candidates.end(), [] (const candidate& a, const candidate& b) {
+        return a.hits > b.hits || (a.hits == b.hits && a.first_seen < b.first_seen);
+    });
+    result.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        const cache_entry& ce = *candidates[i].entry;
+        result.push_back(hot_partition{ce.schema()->id(), ce.key().key(), candidates[i].hits});
+    }
+    return result;
+}
+
 void cache_tracker::insert(cache_entry& entry) {
     insert(entry.partition());
     ++_stats.partition_insertions;
@@ -227,6 +227,13 @@ class cache_tracker final {
             return reads - reads_done;
         }
     };
+    // Identifies a cached partition which was recently and frequently accessed.
+    struct hot_partition {
+        utils::UUID table_id;
+        partition_key key;
+        // Number of the partition's rows found in the scanned head of the LRU.
+        uint64_t hits;
+    };
 private:
     stats _stats{};
     seastar::metrics::metric_groups _metrics;
@@ -270,6 +277,16 @@ class cache_tracker final {
     uint64_t partitions() const { return _stats.partitions; }
     const stats& get_stats() const { return _stats; }
     void set_compaction_scheduling_group(seastar::scheduling_group);
+
+    // Returns at most max_partitions keys of the hottest cached partitions, hottest first.
+    //
+    // Partitions are ranked by the number of their rows among the first max_rows_scanned
+    // entries of the LRU (frequency), ties broken by the position of their most recently
+    // used row (recency). Partitions reachable only from snapshots are skipped.
+    //
+    // Runs without preemption and blocks reclaiming from the cache region, so
+    // max_rows_scanned must be kept small.
+    std::vector<hot_partition> hot_partitions(size_t max_partitions, size_t max_rows_scanned);
 };
 
 inline
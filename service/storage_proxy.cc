@@ -58,6 +58,7 @@
 #include "db/batchlog_manager.hh"
 #include "db/hints/manager.hh"
 #include "db/system_keyspace.hh"
+#include "sstables/sstables.hh"
 #include "exceptions/exceptions.hh"
 #include <boost/range/algorithm_ext/push_back.hpp>
 #include <boost/iterator/counting_iterator.hpp>
@@ -82,6 +83,7 @@
 #include <seastar/util/lazy.hh>
 #include <seastar/core/metrics.hh>
 #include <seastar/core/execution_stage.hh>
+#include <seastar/core/sleep.hh>
 #include "db/timeout_clock.hh"
 #include "multishard_mutation_query.hh"
 
@@ -123,6 +125,22 @@ sstring get_local_dc() {
     return get_dc(local_addr);
 }
 
+// The address of the shard of ep that owns t, see messaging_service::shard_of().
+static inline
+netw::messaging_service::msg_addr replica_addr(gms::inet_address ep, const dht::token& t) {
+    return netw::messaging_service::msg_addr{ep, netw::get_local_messaging_service().shard_of(ep, t)};
+}
+
+static inline
+netw::messaging_service::msg_addr replica_addr(gms::inet_address ep, const schema& s, const frozen_mutation& m) {
+    auto& ms = netw::get_local_messaging_service();
+    // Don't decode the key unless it's needed.
+    if (!ms.shard_aware_connections()) {
+        return netw::messaging_service::msg_addr{ep, 0};
+    }
+    return netw::messaging_service::msg_addr{ep, ms.shard_of(ep, m.decorated_key(s).token())};
+}
+
 class mutation_holder {
 protected:
     size_t _size = 0;
@@ -189,7 +207,7 @@ class shared_mutation : public mutation_holder {
 class abstract_write_response_handler {
 protected:
     storage_proxy::response_id_type _id;
-    promise<> _ready; // available when cl is achieved
+    promise<db::view::update_backlog> _ready; // available when cl is achieved
     shared_ptr<storage_proxy> _proxy;
     tracing::trace_state_ptr _trace_state;
     db::consistency_level _cl;
@@ -214,6 +232,8 @@ class abstract_write_response_handler {
     size_t _all_failures = 0; // total amount of failures
     size_t _total_endpoints = 0;
     storage_proxy::write_stats& _stats;
+    // The largest view update backlog reported by the replicas which responded.
+    db::view::update_backlog _view_update_backlog = db::view::update_backlog::no_backlog();
 
 protected:
     virtual bool waited_for(gms::inet_address from) = 0;
@@ -239,7 +259,7 @@ class abstract_write_response_handler {
         --_stats.writes;
         if (_cl_achieved) {
             if (_throttled) {
-                _ready.set_value();
+                _ready.set_value(_view_update_backlog);
             } else {
                 _stats.background_writes--;
                 _stats.background_write_bytes -= _mutation_holder->size();
@@ -258,7 +278,7 @@ class abstract_write_response_handler {
         _stats.background_writes++;
         _stats.background_write_bytes += _mutation_holder->size();
         _throttled = false;
-        _ready.set_value();
+        _ready.set_value(_view_update_backlog);
     }
     void signal(size_t nr = 1) {
         _cl_acks += nr;
@@ -290,9 +310,10 @@ class abstract_write_response_handler {
         _error = error::TIMEOUT;
     }
     // return true on last ack
-    bool response(gms::inet_address from) {
+    bool response(gms::inet_address from, stdx::optional<db::view::update_backlog> backlog) {
         auto it = _targets.find(from);
         if (it != _targets.end()) {
+            _view_update_backlog = db::view::max_backlog(_view_update_backlog, backlog);
             signal(from);
             _targets.erase(it);
         } else {
@@ -344,7 +365,7 @@ class abstract_write_response_handler {
         on_timeout();
         _proxy->remove_response_handler(_id);
     }
-    future<> wait() {
+    future<db::view::update_backlog> wait() {
         return _ready.get_future();
     }
     const std::unordered_set<gms::inet_address>& get_targets() const {
@@ -519,11 +540,11 @@ void storage_proxy::remove_response_handler(storage_proxy::response_id_type id)
     _response_handlers.erase(id);
 }
 
-void storage_proxy::got_response(storage_proxy::response_id_type id, gms::inet_address from) {
+void storage_proxy::got_response(storage_proxy::response_id_type id, gms::inet_address from, stdx::optional<db::view::update_backlog> backlog) {
     auto it = _response_handlers.find(id);
     if (it != _response_handlers.end()) {
         tracing::trace(it->second.handler->get_trace_state(), "Got a response from /{}", from);
-        if (it->second.handler->response(from)) {
+        if (it->second.handler->response(from, std::move(backlog))) {
             remove_response_handler(id); // last one, remove entry. Will cancel expiration timer too.
         } else {
             it->second.handler->check_for_early_completion();
@@ -548,7 +569,26 @@ future<> storage_proxy::response_wait(storage_proxy::response_id_type id, clock_
 
     e.expire_timer.arm(timeout);
 
-    return e.handler->wait();
+    return e.handler->wait().then([this, timeout] (db::view::update_backlog backlog) {
+        return delay_for_view_update_backlog(backlog, timeout);
+    });
+}
+
+// Replicas which can't keep up with pushing view updates report a growing
+// backlog. Delaying the acknowledgement of writes to them slows down the
+// clients, and keeps the replicas from running out of memory. The delay grows
+// with the cube of the relative backlog, so it is negligible while the backlog
+// is small and approaches the budget as the backlog reaches its limit. It never
+// makes the write time out.
+future<> storage_proxy::delay_for_view_update_backlog(db::view::update_backlog backlog, clock_type::time_point timeout) {
+    auto max_delay = std::chrono::duration_cast<clock_type::duration>(
+            std::chrono::milliseconds(_db.local().get_config().view_update_max_delay_in_ms()));
+    auto delay = db::view::throttling_delay(backlog, std::min(max_delay, timeout - clock_type::now()));
+    if (delay <= clock_type::duration::zero()) {
+        return make_ready_future<>();
+    }
+    ++_stats.view_update_backlog_delayed_writes;
+    return sleep(delay);
 }
 
 ::shared_ptr<abstract_write_response_handler>& storage_proxy::get_write_response_handler(storage_proxy::response_id_type id) {
@@ -689,6 +729,10 @@ storage_proxy::storage_proxy(distributed<database>& db, storage_proxy::config cf
     , _next_response_id(std::chrono::system_clock::now().time_since_epoch()/1ms)
     , _hints_resource_manager(cfg.available_memory / 10)
     , _hints_for_views_manager(_db.local().get_config().data_file_directories()[0] + "/view_pending_updates", {}, _db.local().get_config().max_hint_window_in_ms(), _hints_resource_manager, _db)
+    , _dynamic_snitch(cfg.dynamic_snitch)
+    , _mutation_batcher(cfg.write_batch_window, max_mutation_batch_size, [] (netw::msg_addr ep, clock_type::time_point timeout, std::vector<netw::mutation_batch_entry> entries) {
+        return netw::get_local_messaging_service().send_mutation_batch(ep, timeout, utils::fb_utilities::get_broadcast_address(), std::move(entries));
+    })
     , _background_write_throttle_threahsold(cfg.available_memory / 10)
     , _mutate_stage{"storage_proxy_mutate", &storage_proxy::do_mutate} {
     namespace sm = seastar::metrics;
@@ -707,6 +751,9 @@ storage_proxy::storage_proxy(distributed<database>& db, storage_proxy::config cf
         sm::make_total_operations("throttled_writes", [this] { return _stats.throttled_writes; },
                        sm::description("number of throttled write requests")),
 
+        sm::make_total_operations("view_update_backlog_delayed_writes", [this] { return _stats.view_update_backlog_delayed_writes; },
+                       sm::description("number of write requests delayed because of the view update backlog of the replicas")),
+
         sm::make_current_bytes("queued_write_bytes", [this] { return _stats.queued_write_bytes; },
                        sm::description("number of bytes in pending write requests")),
 
@@ -755,8 +802,17 @@ storage_proxy::storage_proxy(distributed<database>& db, storage_proxy::config cf
         sm::make_total_operations("speculative_data_reads", [this] { return _stats.speculative_data_reads; },
                        sm::description("number of speculative data read requests that were sent")),
 
+        sm::make_total_operations("speculative_reads_latency_adjusted", [this] { return _stats.speculative_reads_latency_adjusted; },
+                       sm::description("number of reads that speculated earlier than the table's latency percentile, based on the replicas' recent latency")),
+
         sm::make_total_operations("background_writes_failed", [this] { return _stats.background_writes_failed; },
                        sm::description("number of write requests that failed after CL was reached")),
+
+        sm::make_total_operations("mutation_batches_sent", [this] { return _mutation_batcher.get_stats().batches_sent; },
+                       sm::description("number of messages sent to replicas carrying a batch of mutations")),
+
+        sm::make_total_operations("batched_mutations", [this] { return _mutation_batcher.get_stats().batched_mutations; },
+                       sm::description("number of mutations sent to replicas as part of a batch")),
     });
 
     _metrics.add_group(REPLICA_STATS_CATEGORY, {
@@ -1217,6 +1273,17 @@ storage_proxy::mutate_locally(const schema_ptr& s, const frozen_mutation& m, clo
     });
 }
 
+future<db::view::update_backlog>
+storage_proxy::mutate_locally_with_view_update_backlog(const schema_ptr& s, const frozen_mutation& m, clock_type::time_point timeout) {
+    auto shard = _db.local().shard_of(m);
+    _stats.replica_cross_shard_ops += shard != engine().cpu_id();
+    return _db.invoke_on(shard, [&m, gs = global_schema_ptr(s), timeout] (database& db) {
+        return db.apply(gs, m, timeout).then([&db] {
+            return db.get_view_update_backlog();
+        });
+    });
+}
+
 future<>
 storage_proxy::mutate_locally(std::vector<mutation> mutations, clock_type::time_point timeout) {
     return do_with(std::move(mutations), [this, timeout] (std::vector<mutation>& pmut){
@@ -1482,12 +1549,12 @@ future<> storage_proxy::mutate_counters(Range&& mutations, db::consistency_level
             f = this->mutate_counters_on_leader(std::move(endpoint_and_mutations.second), cl, timeout, tr_state);
         } else {
             auto& mutations = endpoint_and_mutations.second;
+            auto msg_addr = replica_addr(endpoint_and_mutations.first, *mutations[0].s, mutations[0].fm);
             auto fms = boost::copy_range<std::vector<frozen_mutation>>(mutations | boost::adaptors::transformed([] (auto& m) {
                 return std::move(m.fm);
             }));
 
             auto& ms = netw::get_local_messaging_service();
-            auto msg_addr = netw::messaging_service::msg_addr{ endpoint_and_mutations.first, 0 };
             tracing::trace(tr_state, "Enqueuing counter update to {}", msg_addr);
             f = ms.send_counter_mutation(msg_addr, timeout, std::move(fms), cl, tracing::make_trace_info(tr_state));
         }
@@ -1832,10 +1899,10 @@ void storage_proxy::send_to_live_endpoints(storage_proxy::response_id_type respo
     auto lmutate = [handler_ptr, response_id, this, my_address, timeout] (lw_shared_ptr<const frozen_mutation> m) mutable {
         tracing::trace(handler_ptr->get_trace_state(), "Executing a mutation locally");
         auto s = handler_ptr->get_schema();
-        return mutate_locally(std::move(s), *m, timeout).then([response_id, this, my_address, m, h = std::move(handler_ptr), p = shared_from_this()] {
+        return mutate_locally_with_view_update_backlog(std::move(s), *m, timeout).then([response_id, this, my_address, m, h = std::move(handler_ptr), p = shared_from_this()] (db::view::update_backlog backlog) {
             // make mutation alive until it is processed locally, otherwise it
             // may disappear if write timeouts before this future is ready
-            got_response(response_id, my_address);
+            got_response(response_id, my_address, backlog);
         });
     };
 
@@ -1848,8 +1915,12 @@ void storage_proxy::send_to_live_endpoints(storage_proxy::response_id_type respo
         auto& tr_state = handler_ptr->get_trace_state();
         tracing::trace(tr_state, "Sending a mutation to /{}", coordinator);
 
-        return ms.send_mutation(netw::messaging_service::msg_addr{coordinator, 0}, timeout, m,
-                std::move(forward), my_address, engine().cpu_id(), response_id, tracing::make_trace_info(tr_state)).finally([this, p = shared_from_this(), h = std::move(handler_ptr), msize, &stats] {
+        auto addr = replica_addr(coordinator, *handler_ptr->get_schema(), m);
+        auto f = _mutation_batcher.enabled() && msize <= max_batched_mutation_size && get_local_storage_service().cluster_supports_mutation_batch()
+                ? _mutation_batcher.add(addr, timeout, netw::mutation_batch_entry{m, std::move(forward), engine().cpu_id(), response_id, tracing::make_trace_info(tr_state)})
+                : ms.send_mutation(addr, timeout, m,
+                        std::move(forward), my_address, engine().cpu_id(), response_id, tracing::make_trace_info(tr_state));
+        return f.finally([this, p = shared_from_this(), h = std::move(handler_ptr), msize, &stats] {
             stats.queued_write_bytes -= msize;
             unthrottle();
         });
@@ -2665,8 +2736,8 @@ class data_read_resolver : public abstract_read_resolver {
 
         // build reconcilable_result from reconciled data
         // traverse backwards since large keys are at the start
-        std::vector<partition> vec;
-        auto r = boost::accumulate(reconciled_partitions | boost::adaptors::reversed, std::ref(vec), [] (std::vector<partition>& a, const mutation_and_live_row_count& m_a_rc) {
+        utils::chunked_vector<partition> vec;
+        auto r = boost::accumulate(reconciled_partitions | boost::adaptors::reversed, std::ref(vec), [] (utils::chunked_vector<partition>& a, const mutation_and_live_row_count& m_a_rc) {
             a.emplace_back(partition(m_a_rc.live_row_count, freeze(m_a_rc.mut)));
             return std::ref(a);
         });
@@ -2707,6 +2778,9 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
     promise<foreign_ptr<lw_shared_ptr<query::result>>> _result_promise;
     tracing::trace_state_ptr _trace_state;
     lw_shared_ptr<column_family> _cf;
+    // Chosen once, so that all replicas hash their results the same way even
+    // if the cluster starts supporting a faster algorithm in the middle of the read.
+    query::digest_algorithm _digest_algorithm;
     bool _foreground = true;
 private:
     void on_read_resolved() noexcept {
@@ -2718,7 +2792,7 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
     abstract_read_executor(schema_ptr s, lw_shared_ptr<column_family> cf, shared_ptr<storage_proxy> proxy, lw_shared_ptr<query::read_command> cmd, dht::partition_range pr, db::consistency_level cl, size_t block_for,
             std::vector<gms::inet_address> targets, tracing::trace_state_ptr trace_state) :
                            _schema(std::move(s)), _proxy(std::move(proxy)), _cmd(std::move(cmd)), _partition_range(std::move(pr)), _cl(cl), _block_for(block_for), _targets(std::move(targets)), _trace_state(std::move(trace_state)),
-                           _cf(std::move(cf)) {
+                           _cf(std::move(cf)), _digest_algorithm(digest_algorithm()) {
         _proxy->_stats.reads++;
         _proxy->_stats.foreground_reads++;
     }
@@ -2744,7 +2818,7 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
         } else {
             auto& ms = netw::get_local_messaging_service();
             tracing::trace(_trace_state, "read_mutation_data: sending a message to /{}", ep);
-            return ms.send_read_mutation_data(netw::messaging_service::msg_addr{ep, 0}, timeout, *cmd, _partition_range).then([this, ep](reconcilable_result&& result, rpc::optional<cache_temperature> hit_rate) {
+            return ms.send_read_mutation_data(replica_addr(ep, start_token(_partition_range)), timeout, *cmd, _partition_range).then([this, ep](reconcilable_result&& result, rpc::optional<cache_temperature> hit_rate) {
                 tracing::trace(_trace_state, "read_mutation_data: got response from /{}", ep);
                 return make_ready_future<foreign_ptr<lw_shared_ptr<reconcilable_result>>, cache_temperature>(make_foreign(::make_lw_shared<reconcilable_result>(std::move(result))), hit_rate.value_or(cache_temperature::invalid()));
             });
@@ -2753,7 +2827,7 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
     future<foreign_ptr<lw_shared_ptr<query::result>>, cache_temperature> make_data_request(gms::inet_address ep, clock_type::time_point timeout, bool want_digest) {
         ++_proxy->_stats.data_read_attempts.get_ep_stat(ep);
         auto opts = want_digest
-                  ? query::result_options{query::result_request::result_and_digest, digest_algorithm()}
+                  ? query::result_options{query::result_request::result_and_digest, _digest_algorithm}
                   : query::result_options{query::result_request::only_result, query::digest_algorithm::none};
         if (fbu::is_me(ep)) {
             tracing::trace(_trace_state, "read_data: querying locally");
@@ -2761,7 +2835,7 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
         } else {
             auto& ms = netw::get_local_messaging_service();
             tracing::trace(_trace_state, "read_data: sending a message to /{}", ep);
-            return ms.send_read_data(netw::messaging_service::msg_addr{ep, 0}, timeout, *_cmd, _partition_range, opts.digest_algo).then([this, ep](query::result&& result, rpc::optional<cache_temperature> hit_rate) {
+            return ms.send_read_data(replica_addr(ep, start_token(_partition_range)), timeout, *_cmd, _partition_range, opts.digest_algo).then([this, ep](query::result&& result, rpc::optional<cache_temperature> hit_rate) {
                 tracing::trace(_trace_state, "read_data: got response from /{}", ep);
                 return make_ready_future<foreign_ptr<lw_shared_ptr<query::result>>, cache_temperature>(make_foreign(::make_lw_shared<query::result>(std::move(result))), hit_rate.value_or(cache_temperature::invalid()));
             });
@@ -2771,11 +2845,11 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
         ++_proxy->_stats.digest_read_attempts.get_ep_stat(ep);
         if (fbu::is_me(ep)) {
             tracing::trace(_trace_state, "read_digest: querying locally");
-            return _proxy->query_result_local_digest(_schema, _cmd, _partition_range, _trace_state, timeout, digest_algorithm());
+            return _proxy->query_result_local_digest(_schema, _cmd, _partition_range, _trace_state, timeout, _digest_algorithm);
         } else {
             auto& ms = netw::get_local_messaging_service();
             tracing::trace(_trace_state, "read_digest: sending a message to /{}", ep);
-            return ms.send_read_digest(netw::messaging_service::msg_addr{ep, 0}, timeout, *_cmd, _partition_range, digest_algorithm()).then([this, ep] (query::result_digest d, rpc::optional<api::timestamp_type> t,
+            return ms.send_read_digest(replica_addr(ep, start_token(_partition_range)), timeout, *_cmd, _partition_range, _digest_algorithm).then([this, ep] (query::result_digest d, rpc::optional<api::timestamp_type> t,
                     rpc::optional<cache_temperature> hit_rate) {
                 tracing::trace(_trace_state, "read_digest: got response from /{}", ep);
                 return make_ready_future<query::result_digest, api::timestamp_type, cache_temperature>(d, t ? t.value() : api::missing_timestamp, hit_rate.value_or(cache_temperature::invalid()));
@@ -2799,10 +2873,16 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
     }
     future<> make_data_requests(digest_resolver_ptr resolver, targets_iterator begin, targets_iterator end, clock_type::time_point timeout, bool want_digest) {
         return parallel_for_each(begin, end, [this, resolver = std::move(resolver), timeout, want_digest] (gms::inet_address ep) {
-            return make_data_request(ep, timeout, want_digest).then_wrapped([this, resolver, ep] (future<foreign_ptr<lw_shared_ptr<query::result>>, cache_temperature> f) {
+            utils::latency_counter lc;
+            lc.start();
+            _proxy->_dynamic_snitch.request_started(ep);
+            return futurize_apply([&] { return make_data_request(ep, timeout, want_digest); }).then_wrapped([this, resolver, ep, lc] (future<foreign_ptr<lw_shared_ptr<query::result>>, cache_temperature> f) mutable {
+                // Failures count too, a replica that times out is as slow as the timeout.
+                _proxy->_dynamic_snitch.request_completed(ep, lc.stop().latency());
                 try {
                     auto v = f.get();
                     _cf->set_hit_rate(ep, std::get<1>(v));
+                    _proxy->_dynamic_snitch.record_cache_hit_rate(ep, float(std::get<1>(v)));
                     resolver->add_data(ep, std::get<0>(std::move(v)));
                     ++_proxy->_stats.data_read_completed.get_ep_stat(ep);
                     _used_targets.push_back(ep);
@@ -2815,10 +2895,15 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
     }
     future<> make_digest_requests(digest_resolver_ptr resolver, targets_iterator begin, targets_iterator end, clock_type::time_point timeout) {
         return parallel_for_each(begin, end, [this, resolver = std::move(resolver), timeout] (gms::inet_address ep) {
-            return make_digest_request(ep, timeout).then_wrapped([this, resolver, ep] (future<query::result_digest, api::timestamp_type, cache_temperature> f) {
+            utils::latency_counter lc;
+            lc.start();
+            _proxy->_dynamic_snitch.request_started(ep);
+            return futurize_apply([&] { return make_digest_request(ep, timeout); }).then_wrapped([this, resolver, ep, lc] (future<query::result_digest, api::timestamp_type, cache_temperature> f) mutable {
+                _proxy->_dynamic_snitch.request_completed(ep, lc.stop().latency());
                 try {
                     auto v = f.get();
                     _cf->set_hit_rate(ep, std::get<2>(v));
+                    _proxy->_dynamic_snitch.record_cache_hit_rate(ep, float(std::get<2>(v)));
                     resolver->add_digest(ep, std::get<0>(v), std::get<1>(v));
                     ++_proxy->_stats.digest_read_completed.get_ep_stat(ep);
                     _used_targets.push_back(ep);
@@ -3039,7 +3124,7 @@ class speculating_read_executor : public abstract_read_executor {
         });
         auto& sr = _schema->speculative_retry();
         auto t = (sr.get_type() == speculative_retry::type::PERCENTILE) ?
-            std::min(_cf->get_coordinator_read_latency_percentile(sr.get_value()), std::chrono::milliseconds(_proxy->get_db().local().get_config().read_request_timeout_in_ms()/2)) :
+            std::min(percentile_speculation_delay(sr.get_value()), std::chrono::milliseconds(_proxy->get_db().local().get_config().read_request_timeout_in_ms()/2)) :
             std::chrono::milliseconds(unsigned(sr.get_value()));
         _speculate_timer.arm(t);
 
@@ -3064,6 +3149,21 @@ class speculating_read_executor : public abstract_read_executor {
     virtual void got_cl() override {
         _speculate_timer.cancel();
     }
+private:
+    // The table-wide percentile reflects all replicas over a long period.
+    // When we know how the replicas we are about to wait for have done
+    // recently, speculate as soon as the slowest of them is later than it
+    // usually is, so a single slow replica doesn't hold up the read until
+    // the table's tail latency has passed.
+    std::chrono::milliseconds percentile_speculation_delay(double percentile) const {
+        auto t = _cf->get_coordinator_read_latency_percentile(percentile);
+        auto adjusted = _proxy->_dynamic_snitch.speculation_delay(_targets.begin(), _targets.end() - 1, t);
+        if (adjusted) {
+            ++_proxy->_stats.speculative_reads_latency_adjusted;
+            return *adjusted;
+        }
+        return t;
+    }
 };
 
 class range_slice_read_executor : public never_speculating_read_executor {
@@ -3155,6 +3255,9 @@ ::shared_ptr<abstract_read_executor> storage_proxy::get_read_executor(lw_shared_
         }
     }
 
+    // Both speculating executors treat the last target as the extra one.
+    _dynamic_snitch.order_by_latency(target_replicas, true);
+
     if (retry_type == speculative_retry::type::ALWAYS) {
         return ::make_shared<always_speculating_read_executor>(schema, cf, p, cmd, std::move(pr), cl, block_for, std::move(target_replicas), std::move(trace_state));
     } else {// PERCENTILE or CUSTOM.
@@ -3380,6 +3483,7 @@ storage_proxy::query_partition_key_range_concurrent(storage_proxy::clock_type::t
         exec.push_back(::make_shared<range_slice_read_executor>(schema, cf.shared_from_this(), p, cmd, std::move(range), cl, std::move(filtered_endpoints), trace_state));
         ranges_per_exec.emplace(exec.back().get(), std::move(merged_ranges));
     }
+    size_t ranges_in_round = std::distance(concurrent_fetch_starting_index, i);
 
     query::result_merger merger(cmd->row_limit, cmd->partition_limit);
     merger.reserve(exec.size());
@@ -3389,6 +3493,8 @@ storage_proxy::query_partition_key_range_concurrent(storage_proxy::clock_type::t
     }, std::move(merger));
 
     return f.then([p,
+            schema,
+            ranges_in_round,
             exec = std::move(exec),
             results = std::move(results),
             i = std::move(i),
@@ -3403,6 +3509,9 @@ storage_proxy::query_partition_key_range_concurrent(storage_proxy::clock_type::t
             preferred_replicas = std::move(preferred_replicas),
             ranges_per_exec = std::move(ranges_per_exec)] (foreign_ptr<lw_shared_ptr<query::result>>&& result) mutable {
         result->ensure_counts();
+        bool complete = !result->is_short_read() && result->row_count().value() < remaining_row_count
+                && result->partition_count().value() < remaining_partition_count;
+        auto estimate = p->update_range_scan_estimate(*schema, *cmd, ranges_in_round, *result, complete);
         remaining_row_count -= result->row_count().value();
         remaining_partition_count -= result->partition_count().value();
         results.emplace_back(std::move(result));
@@ -3423,8 +3532,9 @@ storage_proxy::query_partition_key_range_concurrent(storage_proxy::clock_type::t
         } else {
             cmd->row_limit = remaining_row_count;
             cmd->partition_limit = remaining_partition_count;
+            concurrency_factor = range_scan_concurrency(estimate, remaining_row_count, std::distance(i, ranges.end()), concurrency_factor);
             return p->query_partition_key_range_concurrent(timeout, std::move(results), cmd, cl, std::move(i), std::move(ranges),
-                    concurrency_factor * 2, std::move(trace_state), remaining_row_count, remaining_partition_count, std::move(preferred_replicas));
+                    concurrency_factor, std::move(trace_state), remaining_row_count, remaining_partition_count, std::move(preferred_replicas));
         }
     }).handle_exception([p] (std::exception_ptr eptr) {
         p->handle_read_error(eptr, true);
@@ -3452,19 +3562,9 @@ storage_proxy::query_partition_key_range(lw_shared_ptr<query::read_command> cmd,
         }
     }
 
-    // estimate_result_rows_per_range() is currently broken, and this is not needed
-    // when paging is available in any case
-#if 0
-    // our estimate of how many result rows there will be per-range
-    float result_rows_per_range = estimate_result_rows_per_range(cmd, ks);
-    // underestimate how many rows we will get per-range in order to increase the likelihood that we'll
-    // fetch enough rows in the first round
-    result_rows_per_range -= result_rows_per_range * CONCURRENT_SUBREQUESTS_MARGIN;
-    int concurrency_factor = result_rows_per_range == 0.0 ? 1 : std::max(1, std::min(int(ranges.size()), int(std::ceil(cmd->row_limit / result_rows_per_range))));
-#else
-    int result_rows_per_range = 0;
-    int concurrency_factor = 1;
-#endif
+    auto estimate = reads_whole_partitions(*cmd) ? get_range_scan_estimate(*schema, ks) : range_scan_estimate{};
+    auto result_rows_per_range = estimate.rows_per_range;
+    int concurrency_factor = range_scan_concurrency(estimate, cmd->row_limit, ranges.size(), 0);
 
     std::vector<foreign_ptr<lw_shared_ptr<query::result>>> results;
     results.reserve(ranges.size()/concurrency_factor + 1);
@@ -3661,11 +3761,13 @@ std::vector<gms::inet_address> storage_proxy::get_live_endpoints(keyspace& ks, c
 std::vector<gms::inet_address> storage_proxy::get_live_sorted_endpoints(keyspace& ks, const dht::token& token) {
     auto eps = get_live_endpoints(ks, token);
     locator::i_endpoint_snitch::get_local_snitch_ptr()->sort_by_proximity(utils::fb_utilities::get_broadcast_address(), eps);
-    // FIXME: before dynamic snitch is implement put local address (if present) at the beginning
+    // Put the local address (if present) at the beginning, the dynamic snitch
+    // moves it back if it is doing worse than the other local replicas.
     auto it = boost::range::find(eps, utils::fb_utilities::get_broadcast_address());
     if (it != eps.end() && it != eps.begin()) {
         std::iter_swap(it, eps.begin());
     }
+    _dynamic_snitch.sort_by_score(eps);
     return eps;
 }
 
@@ -3679,47 +3781,109 @@ std::vector<gms::inet_address> storage_proxy::intersection(const std::vector<gms
 }
 
 /**
- * Estimate the number of result rows (either cql3 rows or storage rows, as called for by the command) per
- * range in the ring based on our local data.  This assumes that ranges are uniformly distributed across the cluster
- * and that the queried data is also uniformly distributed.
+ * Returns what range scans of the table are expected to return per vnode range.
+ * Until a scan of the table completes a round, the estimate is based on the
+ * local sstables, like system.size_estimates, assuming that data is spread
+ * uniformly over the ring and over the shards.
  */
-float storage_proxy::estimate_result_rows_per_range(lw_shared_ptr<query::read_command> cmd, keyspace& ks)
-{
-    return 1.0;
-#if 0
-    ColumnFamilyStore cfs = keyspace.getColumnFamilyStore(command.columnFamily);
-    float resultRowsPerRange = Float.POSITIVE_INFINITY;
-    if (command.rowFilter != null && !command.rowFilter.isEmpty())
-    {
-        List<SecondaryIndexSearcher> searchers = cfs.indexManager.getIndexSearchersForQuery(command.rowFilter);
-        if (searchers.isEmpty())
-        {
-            resultRowsPerRange = calculateResultRowsUsingEstimatedKeys(cfs);
-        }
-        else
-        {
-            // Secondary index query (cql3 or otherwise).  Estimate result rows based on most selective 2ary index.
-            for (SecondaryIndexSearcher searcher : searchers)
-            {
-                // use our own mean column count as our estimate for how many matching rows each node will have
-                SecondaryIndex highestSelectivityIndex = searcher.highestSelectivityIndex(command.rowFilter);
-                resultRowsPerRange = Math.min(resultRowsPerRange, highestSelectivityIndex.estimateResultRows());
-            }
+storage_proxy::range_scan_estimate storage_proxy::get_range_scan_estimate(const schema& s, keyspace& ks) {
+    auto it = _range_scan_estimates.find(s.id());
+    if (it != _range_scan_estimates.end()) {
+        return it->second;
+    }
+    auto& cf = _db.local().find_column_family(s.id());
+    uint64_t keys = 0;
+    // Only sstables in the mc format count their rows.
+    uint64_t counted_keys = 0;
+    uint64_t counted_rows = 0;
+    utils::estimated_histogram partition_sizes{0};
+    for (auto&& sst : *cf.get_sstables()) {
+        auto sst_keys = sst->get_estimated_key_count();
+        keys += sst_keys;
+        partition_sizes.merge(sst->get_stats_metadata().estimated_row_size);
+        if (sst->get_version() == sstables::sstable_version_types::mc) {
+            counted_keys += sst_keys;
+            counted_rows += sst->get_stats_metadata().rows_count;
         }
     }
-    else if (!command.countCQL3Rows())
-    {
-        // non-cql3 query
-        resultRowsPerRange = cfs.estimateKeys();
+    auto& tm = get_local_storage_service().get_token_metadata();
+    auto local_ranges = tm.get_tokens(utils::fb_utilities::get_broadcast_address()).size() * ks.get_replication_strategy().get_replication_factor();
+    range_scan_estimate e;
+    if (keys && local_ranges) {
+        auto partitions_per_range = float(keys * smp::count) / local_ranges;
+        auto rows_per_partition = counted_keys ? std::max(1.0f, float(counted_rows) / counted_keys) : 1.0f;
+        e.rows_per_range = partitions_per_range * rows_per_partition;
+        e.bytes_per_range = partitions_per_range * partition_sizes.mean();
     }
-    else
-    {
-        resultRowsPerRange = calculateResultRowsUsingEstimatedKeys(cfs);
+    return _range_scan_estimates.emplace(s.id(), e).first->second;
+}
+
+/**
+ * Returns whether the command reads whole partitions, with all of their rows.
+ * Only such scans tell how much a range of the table holds; what sliced scans
+ * return depends on their restrictions.
+ */
+bool storage_proxy::reads_whole_partitions(const query::read_command& cmd) {
+    auto& slice = cmd.slice;
+    auto& ranges = slice.default_row_ranges();
+    return !slice.get_specific_ranges() && ranges.size() == 1 && ranges.front().is_full()
+            && slice.partition_row_limit() == query::max_rows;
+}
+
+/**
+ * Returns the estimate to use for the next round of a range scan, given what
+ * the last one returned. Only scans reading whole partitions update the
+ * table's estimate; other scans go by their previous round alone.
+ */
+storage_proxy::range_scan_estimate
+storage_proxy::update_range_scan_estimate(const schema& s, const query::read_command& cmd, size_t ranges, const query::result& result, bool complete) {
+    range_scan_estimate round;
+    if (ranges) {
+        round.rows_per_range = float(result.row_count().value()) / ranges;
+        round.bytes_per_range = float(result.buf().size()) / ranges;
     }
+    if (!reads_whole_partitions(cmd)) {
+        return round;
+    }
+    auto& e = _range_scan_estimates[s.id()];
+    if (ranges) {
+        e.update(round, complete);
+    }
+    return e;
+}
 
-    // adjust resultRowsPerRange by the number of tokens this node has and the replication factor for this ks
-    return (resultRowsPerRange / DatabaseDescriptor.getNumTokens()) / keyspace.getReplicationStrategy().getReplicationFactor();
-#endif
+void storage_proxy::range_scan_estimate::update(const range_scan_estimate& round, bool complete) {
+    if (complete) {
+        rows_per_range += (round.rows_per_range - rows_per_range) / 2;
+        bytes_per_range += (round.bytes_per_range - bytes_per_range) / 2;
+    } else {
+        // The last range was cut short, so the ranges hold at least that much.
+        rows_per_range = std::max(rows_per_range, round.rows_per_range);
+        bytes_per_range = std::max(bytes_per_range, round.bytes_per_range);
+    }
+}
+
+void storage_proxy::forget_range_scan_estimate(const utils::UUID& table_id) {
+    _range_scan_estimates.erase(table_id);
+}
+
+/**
+ * Returns how many ranges to read in parallel so that one round is likely
+ * to return the remaining rows, without returning much more data than
+ * range_scan_bytes_target. Without an estimate, starts from a single range
+ * and doubles the number of ranges each round. Never reads more than
+ * max_range_scan_concurrency ranges at a time, however low the estimate.
+ */
+int storage_proxy::range_scan_concurrency(const range_scan_estimate& e, uint32_t remaining_rows, size_t remaining_ranges, int previous_concurrency) {
+    // underestimate how many rows we will get per-range in order to increase the likelihood that we'll
+    // fetch enough rows in the first round
+    auto rows_per_range = e.rows_per_range * (1 - CONCURRENT_SUBREQUESTS_MARGIN);
+    double concurrency = rows_per_range > 0 ? std::ceil(remaining_rows / rows_per_range) : std::max(1, previous_concurrency * 2);
+    if (e.bytes_per_range > 0) {
+        concurrency = std::min(concurrency, std::floor(double(range_scan_bytes_target) / e.bytes_per_range));
+    }
+    concurrency = std::min(concurrency, double(max_range_scan_concurrency));
+    return std::max(1, int(std::min(concurrency, double(remaining_ranges))));
 }
 
 #if 0
@@ -4061,12 +4225,13 @@ void storage_proxy::init_messaging_service() {
             });
         });
     });
-    ms.register_mutation([] (const rpc::client_info& cinfo, rpc::opt_time_point t, frozen_mutation in, std::vector<gms::inet_address> forward, gms::inet_address reply_to, unsigned shard, storage_proxy::response_id_type response_id, rpc::optional<std::experimental::optional<tracing::trace_info>> trace_info) {
+    // Applies a mutation received in a MUTATION or MUTATION_BATCH message and forwards it.
+    auto receive_mutation = [] (const rpc::client_info& cinfo, rpc::opt_time_point t, frozen_mutation in, std::vector<gms::inet_address> forward, gms::inet_address reply_to, unsigned shard, storage_proxy::response_id_type response_id, stdx::optional<tracing::trace_info> trace_info) {
         tracing::trace_state_ptr trace_state_ptr;
         auto src_addr = netw::messaging_service::get_source(cinfo);
 
-        if (trace_info && *trace_info) {
-            tracing::trace_info& tr_info = **trace_info;
+        if (trace_info) {
+            tracing::trace_info& tr_info = *trace_info;
             trace_state_ptr = tracing::tracing::get_local_tracing_instance().create_session(tr_info);
             tracing::begin(trace_state_ptr);
             tracing::trace(trace_state_ptr, "Message received from /{}", src_addr.addr);
@@ -4089,9 +4254,9 @@ void storage_proxy::init_messaging_service() {
                 futurize<void>::apply([timeout, &p, &m, reply_to, shard, src_addr = std::move(src_addr)] () mutable {
                     // FIXME: get_schema_for_write() doesn't timeout
                     return get_schema_for_write(m.schema_version(), netw::messaging_service::msg_addr{reply_to, shard}).then([&m, &p, timeout] (schema_ptr s) {
-                        return p->mutate_locally(std::move(s), m, timeout);
+                        return p->mutate_locally_with_view_update_backlog(std::move(s), m, timeout);
                     });
-                }).then([reply_to, shard, response_id, trace_state_ptr] () {
+                }).then([reply_to, shard, response_id, trace_state_ptr] (db::view::update_backlog backlog) {
                     auto& ms = netw::get_local_messaging_service();
                     // We wait for send_mutation_done to complete, otherwise, if reply_to is busy, we will accumulate
                     // lots of unsent responses, which can OOM our shard.
@@ -4099,7 +4264,7 @@ void storage_proxy::init_messaging_service() {
                     // Usually we will return immediately, since this work only involves appending data to the connection
                     // send buffer.
                     tracing::trace(trace_state_ptr, "Sending mutation_done to /{}", reply_to);
-                    return ms.send_mutation_done(netw::messaging_service::msg_addr{reply_to, shard}, shard, response_id).then_wrapped([] (future<> f) {
+                    return ms.send_mutation_done(netw::messaging_service::msg_addr{reply_to, shard}, shard, response_id, backlog).then_wrapped([] (future<> f) {
                         f.ignore_ready_future();
                     });
                 }).handle_exception([reply_to, shard, &p, &errors] (std::exception_ptr eptr) {
@@ -4119,7 +4284,10 @@ void storage_proxy::init_messaging_service() {
                 parallel_for_each(forward.begin(), forward.end(), [reply_to, shard, response_id, &m, &p, trace_state_ptr, timeout, &errors] (gms::inet_address forward) {
                     auto& ms = netw::get_local_messaging_service();
                     tracing::trace(trace_state_ptr, "Forwarding a mutation to /{}", forward);
-                    return ms.send_mutation(netw::messaging_service::msg_addr{forward, 0}, timeout, m, {}, reply_to, shard, response_id, tracing::make_trace_info(trace_state_ptr)).then_wrapped([&p, &errors] (future<> f) {
+                    // The schema is usually known here already; if it isn't, any shard will do.
+                    auto s = local_schema_registry().get_or_null(m.schema_version());
+                    auto addr = s ? replica_addr(forward, *s, m) : netw::messaging_service::msg_addr{forward, 0};
+                    return ms.send_mutation(addr, timeout, m, {}, reply_to, shard, response_id, tracing::make_trace_info(trace_state_ptr)).then_wrapped([&p, &errors] (future<> f) {
                         if (f.failed()) {
                             ++p->_stats.forwarding_errors;
                             errors++;
@@ -4145,12 +4313,29 @@ void storage_proxy::init_messaging_service() {
                 });
             });
         });
+    };
+    ms.register_mutation([receive_mutation] (const rpc::client_info& cinfo, rpc::opt_time_point t, frozen_mutation in, std::vector<gms::inet_address> forward, gms::inet_address reply_to, unsigned shard, storage_proxy::response_id_type response_id, rpc::optional<std::experimental::optional<tracing::trace_info>> trace_info) {
+        return receive_mutation(cinfo, t, std::move(in), std::move(forward), reply_to, shard, response_id, trace_info ? std::move(*trace_info) : stdx::nullopt);
     });
-    ms.register_mutation_done([this] (const rpc::client_info& cinfo, unsigned shard, storage_proxy::response_id_type response_id) {
+    ms.register_mutation_batch([receive_mutation] (const rpc::client_info& cinfo, rpc::opt_time_point t, gms::inet_address reply_to, std::vector<netw::mutation_batch_entry> entries) {
+        // Each mutation is answered on its own, as if it came in a MUTATION message.
+        return do_with(std::move(entries), [&cinfo, t, reply_to, receive_mutation] (std::vector<netw::mutation_batch_entry>& entries) {
+            return parallel_for_each(entries, [&cinfo, t, reply_to, receive_mutation] (netw::mutation_batch_entry& e) {
+                return receive_mutation(cinfo, t, std::move(e.fm), std::move(e.forward), reply_to, e.shard, e.response_id, std::move(e.trace_info)).discard_result();
+            });
+        }).then([] {
+            return netw::messaging_service::no_wait();
+        });
+    });
+    ms.register_mutation_done([this] (const rpc::client_info& cinfo, unsigned shard, storage_proxy::response_id_type response_id, rpc::optional<db::view::update_backlog> backlog) {
         auto& from = cinfo.retrieve_auxiliary<gms::inet_address>("baddr");
         _stats.replica_cross_shard_ops += shard != engine().cpu_id();
-        return get_storage_proxy().invoke_on(shard, [from, response_id] (storage_proxy& sp) {
-            sp.got_response(response_id, from);
+        stdx::optional<db::view::update_backlog> b;
+        if (backlog) {
+            b = *backlog;
+        }
+        return get_storage_proxy().invoke_on(shard, [from, response_id, b] (storage_proxy& sp) {
+            sp.got_response(response_id, from, b);
             return netw::messaging_service::no_wait();
         });
     });
@@ -4267,6 +4452,7 @@ void storage_proxy::init_messaging_service() {
 void storage_proxy::uninit_messaging_service() {
     auto& ms = netw::get_local_messaging_service();
     ms.unregister_mutation();
+    ms.unregister_mutation_batch();
     ms.unregister_mutation_done();
     ms.unregister_mutation_failed();
     ms.unregister_read_data();
@@ -4333,6 +4519,9 @@ future<> storage_proxy::stop_hints_manager() {
 future<>
 storage_proxy::stop() {
     // FIXME: hints manager should be stopped here but it seems like this function is never called
+    // Writes waiting in a batch fail like the ones whose messages are cut
+    // off by the shutdown, later ones are sent on their own.
+    _mutation_batcher.stop(std::make_exception_ptr(seastar::gate_closed_exception()));
     uninit_messaging_service();
     return make_ready_future<>();
 }
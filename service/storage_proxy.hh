@@ -52,9 +52,12 @@
 #include "db/hints/manager.hh"
 #include "utils/histogram.hh"
 #include "utils/estimated_histogram.hh"
+#include "locator/dynamic_snitch.hh"
 #include "tracing/trace_state.hh"
 #include <seastar/core/metrics.hh>
 #include "frozen_mutation.hh"
+#include "message/msg_addr.hh"
+#include "message/mutation_batch.hh"
 #include "db/config.hh"
 #include "storage_proxy_stats.hh"
 
@@ -78,6 +81,10 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
     struct config {
         stdx::optional<std::vector<sstring>> hinted_handoff_enabled = {};
         size_t available_memory;
+        locator::dynamic_snitch::config dynamic_snitch;
+        // How long to hold small mutations for a replica so that they are sent
+        // together in one message. Zero disables batching.
+        std::chrono::microseconds write_batch_window = std::chrono::microseconds(0);
     };
 private:
     struct rh_entry {
@@ -141,6 +148,22 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
             , read_repair_decision(std::move(read_repair_decision)) {
         }
     };
+
+    // What range scans of a table recently returned per vnode range. Used to
+    // decide how many ranges to read in parallel, and kept across pages and
+    // queries so that each page doesn't start again from a single range.
+    struct range_scan_estimate {
+        float rows_per_range = 0;
+        float bytes_per_range = 0;
+
+        // Moves the estimate toward what a round of a scan returned.
+        void update(const range_scan_estimate& round, bool complete);
+    };
+    // How much data the ranges a range scan reads in parallel may return together.
+    static constexpr size_t range_scan_bytes_target = 4 * query::result_memory_limiter::maximum_result_size;
+    // How many ranges a range scan may read in parallel, whatever the estimate.
+    static constexpr int max_range_scan_concurrency = 128;
+    static int range_scan_concurrency(const range_scan_estimate& e, uint32_t remaining_rows, size_t remaining_ranges, int previous_concurrency);
 private:
     distributed<database>& _db;
     response_id_type _next_response_id;
@@ -157,7 +180,17 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
     stdx::optional<db::hints::manager> _hints_manager;
     db::hints::manager _hints_for_views_manager;
     stats _stats;
+    // Tracks how replicas have been answering reads from this shard. Used to
+    // steer reads away from replicas that are slow right now, and to decide
+    // when to speculate.
+    locator::dynamic_snitch _dynamic_snitch;
+    // Larger mutations gain nothing from batching and are sent on their own.
+    static constexpr size_t max_batched_mutation_size = 16 * 1024;
+    // A batch is sent right away once it grows this large.
+    static constexpr size_t max_mutation_batch_size = 128 * 1024;
+    netw::mutation_batcher _mutation_batcher;
     static constexpr float CONCURRENT_SUBREQUESTS_MARGIN = 0.10;
+    std::unordered_map<utils::UUID, range_scan_estimate> _range_scan_estimates;
     // for read repair chance calculation
     std::default_random_engine _urandom;
     std::uniform_real_distribution<> _read_repair_chance = std::uniform_real_distribution<>(0,1);
@@ -179,9 +212,10 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
             coordinator_query_options optional_params);
     response_id_type register_response_handler(shared_ptr<abstract_write_response_handler>&& h);
     void remove_response_handler(response_id_type id);
-    void got_response(response_id_type id, gms::inet_address from);
+    void got_response(response_id_type id, gms::inet_address from, stdx::optional<db::view::update_backlog> backlog = {});
     void got_failure_response(response_id_type id, gms::inet_address from, size_t count);
     future<> response_wait(response_id_type id, clock_type::time_point timeout);
+    future<> delay_for_view_update_backlog(db::view::update_backlog backlog, clock_type::time_point timeout);
     ::shared_ptr<abstract_write_response_handler>& get_write_response_handler(storage_proxy::response_id_type id);
     response_id_type create_write_response_handler(keyspace& ks, db::consistency_level cl, db::write_type type, std::unique_ptr<mutation_holder> m, std::unordered_set<gms::inet_address> targets,
             const std::vector<gms::inet_address>& pending_endpoints, std::vector<gms::inet_address>, tracing::trace_state_ptr tr_state, storage_proxy::write_stats& stats);
@@ -219,7 +253,9 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
             dht::partition_range_vector partition_ranges,
             db::consistency_level cl,
             coordinator_query_options optional_params);
-    float estimate_result_rows_per_range(lw_shared_ptr<query::read_command> cmd, keyspace& ks);
+    range_scan_estimate get_range_scan_estimate(const schema& s, keyspace& ks);
+    static bool reads_whole_partitions(const query::read_command& cmd);
+    range_scan_estimate update_range_scan_estimate(const schema& s, const query::read_command& cmd, size_t ranges, const query::result& result, bool complete);
     static std::vector<gms::inet_address> intersection(const std::vector<gms::inet_address>& l1, const std::vector<gms::inet_address>& l2);
     future<std::vector<foreign_ptr<lw_shared_ptr<query::result>>>, replicas_per_token_range> query_partition_key_range_concurrent(clock_type::time_point timeout,
             std::vector<foreign_ptr<lw_shared_ptr<query::result>>>&& results,
@@ -294,6 +330,8 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
     // Applies mutation on this node.
     // Resolves with timed_out_error when timeout is reached.
     future<> mutate_locally(const schema_ptr&, const frozen_mutation& m, clock_type::time_point timeout = clock_type::time_point::max());
+    // Like mutate_locally(), but also resolves with the view update backlog of the shard which applied the mutation.
+    future<db::view::update_backlog> mutate_locally_with_view_update_backlog(const schema_ptr&, const frozen_mutation& m, clock_type::time_point timeout);
     // Applies mutations on this node.
     // Resolves with timed_out_error when timeout is reached.
     future<> mutate_locally(std::vector<mutation> mutation, clock_type::time_point timeout = clock_type::time_point::max());
@@ -302,6 +340,9 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
 
     dht::partition_range_vector get_restricted_ranges(const schema& s, dht::partition_range range);
 
+    // Drops what range scans of the table were found to return, once it is dropped.
+    void forget_range_scan_estimate(const utils::UUID& table_id);
+
     /**
     * Use this method to have these Mutations applied
     * across all replicas. This method will take care
@@ -397,6 +438,10 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
     future<> start_hints_manager(shared_ptr<gms::gossiper> gossiper_ptr, shared_ptr<service::storage_service> ss_ptr);
     void allow_replaying_hints() noexcept;
 
+    const locator::dynamic_snitch& get_dynamic_snitch() const {
+        return _dynamic_snitch;
+    }
+
     const stats& get_stats() const {
         return _stats;
     }
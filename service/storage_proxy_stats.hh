@@ -97,6 +97,7 @@ struct write_stats {
     uint64_t background_write_bytes = 0;
     uint64_t queued_write_bytes = 0;
     uint64_t throttled_writes = 0; // total number of writes ever delayed due to throttling
+    uint64_t view_update_backlog_delayed_writes = 0; // total number of writes delayed due to the view update backlog of replicas
     uint64_t background_writes_failed = 0;
 public:
     write_stats();
@@ -143,6 +144,7 @@ struct stats : public write_stats {
     uint64_t read_retries = 0; // read is retried with new limit
     uint64_t speculative_digest_reads = 0;
     uint64_t speculative_data_reads = 0;
+    uint64_t speculative_reads_latency_adjusted = 0; // speculation delay lowered to the replicas' recent latency
 
     // Data read attempts
     split_stats data_read_attempts;
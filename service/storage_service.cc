@@ -101,6 +101,8 @@ static const sstring ROLES_FEATURE = "ROLES";
 static const sstring LA_SSTABLE_FEATURE = "LA_SSTABLE_FORMAT";
 static const sstring STREAM_WITH_RPC_STREAM = "STREAM_WITH_RPC_STREAM";
 static const sstring MC_SSTABLE_FEATURE = "MC_SSTABLE_FORMAT";
+static const sstring LOCAL_INDEXES_FEATURE = "LOCAL_INDEXES";
+static const sstring MUTATION_BATCH_FEATURE = "MUTATION_BATCH";
 
 distributed<storage_service> _the_storage_service;
 
@@ -210,7 +212,9 @@ sstring storage_service::get_config_supported_features() {
         LA_SSTABLE_FEATURE,
         STREAM_WITH_RPC_STREAM,
         MATERIALIZED_VIEWS_FEATURE,
-        INDEXES_FEATURE
+        INDEXES_FEATURE,
+        LOCAL_INDEXES_FEATURE,
+        MUTATION_BATCH_FEATURE
     };
     auto& config = service::get_local_storage_service()._db.local().get_config();
     if (config.enable_sstables_mc_format()) {
@@ -393,6 +397,8 @@ void storage_service::prepare_to_join(std::vector<inet_address> loaded_endpoints
     app_states.emplace(gms::application_state::SUPPORTED_FEATURES, value_factory.supported_features(features));
     app_states.emplace(gms::application_state::CACHE_HITRATES, value_factory.cache_hitrates(""));
     app_states.emplace(gms::application_state::SCHEMA_TABLES_VERSION, versioned_value(db::schema_tables::version));
+    app_states.emplace(gms::application_state::SHARD_COUNT, value_factory.shard_count(smp::count));
+    app_states.emplace(gms::application_state::IGNORE_MSB_BITS, value_factory.ignore_msb_bits(dht::global_partitioner().sharding_ignore_msb()));
     slogger.info("Starting up server gossip");
 
     auto& gossiper = gms::get_local_gossiper();
@@ -435,6 +441,8 @@ void storage_service::register_features() {
     _mc_sstable_feature = gms::feature(MC_SSTABLE_FEATURE);
     _materialized_views_feature = gms::feature(MATERIALIZED_VIEWS_FEATURE);
     _indexes_feature = gms::feature(INDEXES_FEATURE);
+    _local_indexes_feature = gms::feature(LOCAL_INDEXES_FEATURE);
+    _mutation_batch_feature = gms::feature(MUTATION_BATCH_FEATURE);
 }
 
 // Runs inside seastar::async context
@@ -1115,6 +1123,9 @@ void storage_service::on_change(inet_address endpoint, application_state state,
             slogger.debug("Ignoring state change for dead or unknown endpoint: {}", endpoint);
             return;
         }
+        if (state == application_state::SHARD_COUNT || state == application_state::IGNORE_MSB_BITS) {
+            update_peer_sharding(endpoint, *ep_state);
+        }
         if (get_token_metadata().is_member(endpoint)) {
             do_update_system_peers_table(endpoint, state, value);
             if (state == application_state::SCHEMA) {
@@ -1127,8 +1138,29 @@ void storage_service::on_change(inet_address endpoint, application_state state,
 }
 
 
+// Runs inside seastar::async context
+void storage_service::update_peer_sharding(inet_address endpoint, const gms::endpoint_state& ep_state) {
+    auto* shard_count = ep_state.get_application_state_ptr(application_state::SHARD_COUNT);
+    auto* ignore_msb_bits = ep_state.get_application_state_ptr(application_state::IGNORE_MSB_BITS);
+    if (!shard_count || !ignore_msb_bits) {
+        return;
+    }
+    try {
+        auto shards = boost::lexical_cast<unsigned>(shard_count->value);
+        auto msb = boost::lexical_cast<unsigned>(ignore_msb_bits->value);
+        netw::get_messaging_service().invoke_on_all([endpoint, shards, msb] (auto& ms) {
+            ms.set_peer_sharding(endpoint, shards, msb);
+        }).get();
+    } catch (const boost::bad_lexical_cast&) {
+        slogger.warn("Invalid sharding of {}: shard_count={}, ignore_msb_bits={}", endpoint, shard_count->value, ignore_msb_bits->value);
+    }
+}
+
 void storage_service::on_remove(gms::inet_address endpoint) {
     slogger.debug("endpoint={} on_remove", endpoint);
+    netw::get_messaging_service().invoke_on_all([endpoint] (auto& ms) {
+        ms.remove_peer_sharding(endpoint);
+    }).get();
     _token_metadata.remove_endpoint(endpoint);
     update_pending_ranges().get();
 }
@@ -2100,6 +2132,9 @@ future<> storage_service::start_native_transport() {
         cql_transport::cql_server_config cql_server_config;
         cql_server_config.timeout_config = make_timeout_config(cfg);
         cql_server_config.max_request_size = ss._db.local().get_available_memory() / 10;
+        if (cfg.native_shard_aware_transport_port()) {
+            cql_server_config.shard_aware_transport_port = cfg.native_shard_aware_transport_port();
+        }
         cql_transport::cql_load_balance lb = cql_transport::parse_load_balance(cfg.load_balance());
         return seastar::net::dns::resolve_name(addr).then([&ss, cserver, addr, &cfg, lb, keepalive, ceo = std::move(ceo), cql_server_config] (seastar::net::inet_address ip) {
                 return cserver->start(std::ref(service::get_storage_proxy()), std::ref(cql3::get_query_processor()), lb, std::ref(ss._auth_service), cql_server_config).then([cserver, &cfg, addr, ip, ceo, keepalive]() {
@@ -2113,9 +2148,13 @@ future<> storage_service::start_native_transport() {
                 struct listen_cfg {
                     ipv4_addr addr;
                     std::shared_ptr<seastar::tls::credentials_builder> cred;
+                    bool is_shard_aware = false;
                 };
 
                 std::vector<listen_cfg> configs({ { ipv4_addr{ip, cfg.native_transport_port()} }});
+                if (cfg.native_shard_aware_transport_port()) {
+                    configs.emplace_back(listen_cfg{ipv4_addr{ip, cfg.native_shard_aware_transport_port()}, {}, true});
+                }
 
                 // main should have made sure values are clean and neatish
                 if (ceo.at("enabled") == "true") {
@@ -2141,15 +2180,18 @@ future<> storage_service::start_native_transport() {
                     if (cfg.native_transport_port_ssl.is_set() && cfg.native_transport_port_ssl() != cfg.native_transport_port()) {
                         configs.emplace_back(listen_cfg{ipv4_addr{ip, cfg.native_transport_port_ssl()}, std::move(cred)});
                     } else {
-                        configs.back().cred = std::move(cred);
+                        // The shard-aware port, if any, follows native_transport_port.
+                        for (auto& c : configs) {
+                            c.cred = cred;
+                        }
                     }
                 }
 
                 return f.then([cserver, configs = std::move(configs), keepalive] {
                     return parallel_for_each(configs, [cserver, keepalive](const listen_cfg & cfg) {
-                        return cserver->invoke_on_all(&cql_transport::cql_server::listen, cfg.addr, cfg.cred, keepalive).then([cfg] {
-                            slogger.info("Starting listening for CQL clients on {} ({})"
-                                            , cfg.addr, cfg.cred ? "encrypted" : "unencrypted"
+                        return cserver->invoke_on_all(&cql_transport::cql_server::listen, cfg.addr, cfg.cred, cfg.is_shard_aware, keepalive).then([cfg] {
+                            slogger.info("Starting listening for CQL clients on {} ({}, {})"
+                                            , cfg.addr, cfg.cred ? "encrypted" : "unencrypted", cfg.is_shard_aware ? "shard-aware" : "non-shard-aware"
                                             );
                         });
                     });
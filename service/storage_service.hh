@@ -290,6 +290,8 @@ class storage_service : public service::migration_listener, public gms::i_endpoi
     gms::feature _la_sstable_feature;
     gms::feature _stream_with_rpc_stream_feature;
     gms::feature _mc_sstable_feature;
+    gms::feature _local_indexes_feature;
+    gms::feature _mutation_batch_feature;
 public:
     void enable_all_features() {
         _range_tombstones_feature.enable();
@@ -307,6 +309,8 @@ class storage_service : public service::migration_listener, public gms::i_endpoi
         _la_sstable_feature.enable();
         _stream_with_rpc_stream_feature.enable();
         _mc_sstable_feature.enable();
+        _local_indexes_feature.enable();
+        _mutation_batch_feature.enable();
     }
 
     void finish_bootstrapping() {
@@ -737,6 +741,7 @@ class storage_service : public service::migration_listener, public gms::i_endpoi
 private:
     void update_peer_info(inet_address endpoint);
     void do_update_system_peers_table(gms::inet_address endpoint, const application_state& state, const versioned_value& value);
+    void update_peer_sharding(inet_address endpoint, const gms::endpoint_state& ep_state);
     sstring get_application_state_value(inet_address endpoint, application_state appstate);
     std::unordered_set<token> get_tokens_for(inet_address endpoint);
     future<> replicate_to_all_cores();
@@ -2293,6 +2298,14 @@ class storage_service : public service::migration_listener, public gms::i_endpoi
     bool cluster_supports_mc_sstable() const {
         return bool(_mc_sstable_feature);
     }
+
+    bool cluster_supports_local_indexes() const {
+        return bool(_local_indexes_feature);
+    }
+
+    bool cluster_supports_mutation_batch() const {
+        return bool(_mutation_batch_feature);
+    }
 };
 
 inline future<> init_storage_service(distributed<database>& db, sharded<auth::service>& auth_service, sharded<db::system_distributed_keyspace>& sys_dist_ks) {
@@ -49,6 +49,7 @@ boost_tests = [
     'sstable_mutation_test',
     'sstable_resharding_test',
     'commitlog_test',
+    'commitlog_replayer_test',
     'hash_test',
     'test-serialization',
     'cartesian_product_test',
@@ -73,11 +74,15 @@ boost_tests = [
     'config_test',
     'dynamic_bitset_test',
     'gossip_test',
+    'messaging_service_test',
+    'hints_test',
+    'cache_warmer_test',
     'managed_vector_test',
     'map_difference_test',
     'memtable_test',
     'mutation_query_test',
     'snitch_reset_test',
+    'dynamic_snitch_test',
     'auth_test',
     'idl_test',
     'range_tombstone_list_test',
@@ -93,6 +98,7 @@ boost_tests = [
     'view_schema_test',
     'view_build_test',
     'view_complex_test',
+    'view_update_test',
     'clustering_ranges_walker_test',
     'vint_serialization_test',
     'duration_test',
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2018 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+#include <seastar/util/defer.hh>
+
+#include "tests/test-utils.hh"
+#include "tests/cql_test_env.hh"
+#include "tests/tmpdir.hh"
+#include "db/cache_warmer.hh"
+#include "database.hh"
+
+static db::cache_warmer::config make_config(const tmpdir& dir) {
+    db::cache_warmer::config cfg;
+    cfg.directory = dir.path;
+    cfg.save_period = std::chrono::seconds(0);
+    cfg.keys_to_save = 1000;
+    cfg.warmup_bandwidth = 0;
+    return cfg;
+}
+
+SEASTAR_TEST_CASE(test_save_and_warm_up) {
+    return do_with_cql_env_thread([] (cql_test_env& e) {
+        e.execute_cql("CREATE TABLE t (p int PRIMARY KEY, v int)").get();
+        for (int i = 0; i < 32; ++i) {
+            e.execute_cql(sprint("INSERT INTO t (p, v) VALUES (%d, %d)", i, i)).get();
+        }
+        auto& cf = e.local_db().find_column_family("ks", "t");
+        cf.flush().get();
+        auto& cache = cf.get_row_cache();
+        cache.invalidate([] {}).get();
+        auto empty = cache.partitions();
+
+        // Read the whole table through the cache, so that its partitions become hot.
+        e.execute_cql("SELECT * FROM t").get();
+        auto populated = cache.partitions();
+        BOOST_REQUIRE_GT(populated, empty);
+
+        tmpdir dir;
+        {
+            db::cache_warmer warmer(e.local_db(), make_config(dir));
+            auto stop_warmer = defer([&warmer] { warmer.stop().get(); });
+            warmer.save().get();
+            BOOST_REQUIRE_EQUAL(warmer.get_stats().saves, 1);
+            BOOST_REQUIRE_EQUAL(warmer.get_stats().save_errors, 0);
+            BOOST_REQUIRE_GE(warmer.get_stats().keys_saved, populated - empty);
+        }
+
+        cache.invalidate([] {}).get();
+        BOOST_REQUIRE_EQUAL(cache.partitions(), empty);
+
+        // A fresh instance, as after a restart, reads the saved keys back.
+        db::cache_warmer warmer(e.local_db(), make_config(dir));
+        auto stop_warmer = defer([&warmer] { warmer.stop().get(); });
+        warmer.warm_up().get();
+        auto& stats = warmer.get_stats();
+        BOOST_REQUIRE(stats.warmup_done);
+        BOOST_REQUIRE_EQUAL(stats.warmup_partitions_loaded, stats.warmup_partitions_found);
+        BOOST_REQUIRE_GE(stats.warmup_partitions_loaded, populated - empty);
+        BOOST_REQUIRE_GT(stats.warmup_bytes, 0);
+        BOOST_REQUIRE_EQUAL(cache.partitions(), populated);
+    });
+}
+
+SEASTAR_TEST_CASE(test_warm_up_skips_dropped_tables) {
+    return do_with_cql_env_thread([] (cql_test_env& e) {
+        e.execute_cql("CREATE TABLE t (p int PRIMARY KEY, v int)").get();
+        for (int i = 0; i < 32; ++i) {
+            e.execute_cql(sprint("INSERT INTO t (p, v) VALUES (%d, %d)", i, i)).get();
+        }
+        auto& cf = e.local_db().find_column_family("ks", "t");
+        cf.flush().get();
+        cf.get_row_cache().invalidate([] {}).get();
+        auto empty = cf.get_row_cache().partitions();
+        e.execute_cql("SELECT * FROM t").get();
+        auto cached = cf.get_row_cache().partitions() - empty;
+
+        tmpdir dir;
+        {
+            db::cache_warmer warmer(e.local_db(), make_config(dir));
+            auto stop_warmer = defer([&warmer] { warmer.stop().get(); });
+            warmer.save().get();
+        }
+
+        e.execute_cql("DROP TABLE t").get();
+
+        db::cache_warmer warmer(e.local_db(), make_config(dir));
+        auto stop_warmer = defer([&warmer] { warmer.stop().get(); });
+        warmer.warm_up().get();
+        BOOST_REQUIRE(warmer.get_stats().warmup_done);
+        BOOST_REQUIRE_GE(warmer.get_stats().warmup_partitions_skipped, cached);
+    });
+}
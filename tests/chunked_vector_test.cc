@@ -176,3 +176,21 @@ BOOST_AUTO_TEST_CASE(tests_constructor_exception_safety) {
         BOOST_REQUIRE(checker.ok());
     }
 }
+
+BOOST_AUTO_TEST_CASE(test_reverse_iteration) {
+    disk_array c;
+    deque d;
+    // Span several chunks.
+    for (auto i : boost::irange(0, 1000)) {
+        c.push_back(i);
+        d.push_back(i);
+    }
+    BOOST_REQUIRE(std::equal(c.rbegin(), c.rend(), d.rbegin(), d.rend()));
+    BOOST_REQUIRE(std::equal(c.crbegin(), c.crend(), d.crbegin(), d.crend()));
+    while (!d.empty()) {
+        BOOST_REQUIRE_EQUAL(*c.rbegin(), d.back());
+        c.pop_back();
+        d.pop_back();
+    }
+    BOOST_REQUIRE(c.rbegin() == c.rend());
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2018 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+#include <seastar/util/defer.hh>
+
+#include "tests/test-utils.hh"
+#include "tests/cql_test_env.hh"
+#include "tests/cql_assertions.hh"
+#include "tests/tmpdir.hh"
+#include "db/commitlog/commitlog.hh"
+#include "db/commitlog/commitlog_entry.hh"
+#include "db/commitlog/commitlog_replayer.hh"
+#include "db/commitlog/rp_set.hh"
+#include "database.hh"
+
+SEASTAR_TEST_CASE(test_replay_applies_each_mutation_once) {
+    return do_with_cql_env_thread([] (cql_test_env& e) {
+        e.execute_cql("CREATE TABLE t (p int PRIMARY KEY, v blob)").get();
+        auto s = e.local_db().find_schema("ks", "t");
+
+        tmpdir dir;
+        db::commitlog::config cfg;
+        cfg.commit_log_location = dir.path;
+        cfg.commitlog_segment_size_in_mb = 1;
+        auto cl = db::commitlog::create_commitlog(cfg).get0();
+        auto close_cl = defer([&cl] {
+            cl.shutdown().get();
+            cl.clear().get();
+        });
+
+        // Large enough values to spread the mutations over several segments,
+        // and enough keys for every shard to own some of them.
+        const int keys = 1000;
+        std::set<unsigned> shards;
+        db::rp_set handles;
+        for (int i = 0; i < keys; ++i) {
+            mutation m(s, partition_key::from_single_value(*s, int32_type->decompose(i)));
+            m.set_clustered_cell(clustering_key::make_empty(), "v", data_value(bytes(4096, int8_t(i))), api::new_timestamp());
+            shards.insert(dht::shard_of(m.token()));
+            auto fm = freeze(m);
+            commitlog_entry_writer cew(s, fm);
+            handles.put(cl.add_entry(s->id(), cew, db::no_timeout).get0());
+        }
+        cl.sync_all_segments().get();
+        BOOST_REQUIRE_EQUAL(shards.size(), smp::count);
+
+        auto segments = cl.get_active_segment_names();
+        BOOST_REQUIRE_GT(segments.size(), 1);
+
+        auto rp = db::commitlog_replayer::create_replayer(e.qp()).get0();
+        rp.recover(segments, db::commitlog::descriptor::FILENAME_PREFIX.c_str()).get();
+
+        auto& stats = rp.get_stats();
+        BOOST_REQUIRE_EQUAL(stats.applied_mutations, keys);
+        BOOST_REQUIRE_EQUAL(stats.invalid_mutations, 0);
+        BOOST_REQUIRE_EQUAL(stats.skipped_mutations, 0);
+        BOOST_REQUIRE_EQUAL(stats.corrupt_bytes, 0);
+
+        auto msg = e.execute_cql("SELECT p FROM t").get0();
+        assert_that(msg).is_rows().with_size(keys);
+        for (int i : {0, keys / 2, keys - 1}) {
+            msg = e.execute_cql(sprint("SELECT v FROM t WHERE p = %d", i)).get0();
+            assert_that(msg).is_rows().with_rows({{bytes(4096, int8_t(i))}});
+        }
+    });
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2018 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+#include <seastar/util/defer.hh>
+
+#include "tests/test-utils.hh"
+#include "locator/dynamic_snitch.hh"
+#include "locator/snitch_base.hh"
+#include "utils/latency_estimator.hh"
+
+using namespace std::chrono_literals;
+using inet_address = gms::inet_address;
+
+SEASTAR_TEST_CASE(test_latency_estimator) {
+    utils::latency_estimator e;
+    BOOST_REQUIRE(!e.has_samples());
+    BOOST_REQUIRE(!e.is_fresh(10s));
+
+    // The first sample sets the mean, with a deviation of half of it.
+    e.add(10ms);
+    BOOST_REQUIRE(e.has_samples());
+    BOOST_REQUIRE(e.is_fresh(10s));
+    BOOST_REQUIRE(e.mean() == 10ms);
+    BOOST_REQUIRE(e.deviation() == 5ms);
+    BOOST_REQUIRE(e.high_estimate() == 30ms);
+
+    // Steady samples keep the mean and shrink the deviation.
+    for (int i = 0; i < 50; ++i) {
+        e.add(10ms);
+    }
+    BOOST_REQUIRE(e.mean() == 10ms);
+    BOOST_REQUIRE(e.deviation() < 1ms);
+    BOOST_REQUIRE(e.high_estimate() < 14ms);
+
+    // A new sample moves the mean by an eighth of the difference.
+    e.add(18ms);
+    BOOST_REQUIRE(e.mean() == 11ms);
+    BOOST_REQUIRE(e.deviation() > 1ms);
+
+    // And the estimate follows a change within a few dozen samples.
+    for (int i = 0; i < 50; ++i) {
+        e.add(50ms);
+    }
+    BOOST_REQUIRE(e.mean() > 49ms);
+    BOOST_REQUIRE(e.mean() <= 50ms);
+    return make_ready_future<>();
+}
+
+static locator::dynamic_snitch::config make_config() {
+    locator::dynamic_snitch::config cfg;
+    cfg.enabled = true;
+    cfg.reset_interval = 0ms;
+    cfg.badness_threshold = 0.1;
+    return cfg;
+}
+
+static void record(locator::dynamic_snitch& ds, inet_address ep, locator::dynamic_snitch::duration latency) {
+    ds.request_started(ep);
+    ds.request_completed(ep, latency);
+}
+
+SEASTAR_TEST_CASE(test_order_by_latency) {
+    return seastar::async([] {
+        locator::i_endpoint_snitch::create_snitch("SimpleSnitch").get();
+        auto stop_snitch = defer([] { locator::i_endpoint_snitch::stop_snitch().get(); });
+
+        auto a = inet_address("127.0.0.1");
+        auto b = inet_address("127.0.0.2");
+        auto c = inet_address("127.0.0.3");
+        using targets = std::vector<inet_address>;
+
+        {
+            // Without estimates for all contacted replicas the order is kept.
+            locator::dynamic_snitch ds(make_config());
+            record(ds, b, 1ms);
+            auto t = targets{a, b, c};
+            ds.order_by_latency(t, true);
+            BOOST_REQUIRE(t == targets({a, b, c}));
+        }
+        {
+            // The preferred replica is kept while it is within the badness threshold of the fastest one.
+            locator::dynamic_snitch ds(make_config());
+            record(ds, a, 10500us);
+            record(ds, b, 10ms);
+            auto t = targets{a, b, c};
+            ds.order_by_latency(t, true);
+            BOOST_REQUIRE(t == targets({a, b, c}));
+
+            // But not once it is much slower.
+            record(ds, a, 50ms);
+            record(ds, a, 50ms);
+            record(ds, a, 50ms);
+            t = targets{a, b, c};
+            ds.order_by_latency(t, true);
+            BOOST_REQUIRE(t == targets({b, a, c}));
+
+            // Without an extra replica all targets are ordered.
+            t = targets{a, b};
+            ds.order_by_latency(t, false);
+            BOOST_REQUIRE(t == targets({b, a}));
+        }
+        {
+            // A much faster extra replica takes the place of the slowest contacted one.
+            locator::dynamic_snitch ds(make_config());
+            record(ds, a, 10ms);
+            record(ds, b, 30ms);
+            record(ds, c, 5ms);
+            auto t = targets{a, b, c};
+            ds.order_by_latency(t, true);
+            BOOST_REQUIRE(t == targets({c, a, b}));
+
+            // But not if it is only a bit faster.
+            for (int i = 0; i < 20; ++i) {
+                record(ds, c, 20ms);
+            }
+            t = targets{a, b, c};
+            ds.order_by_latency(t, true);
+            BOOST_REQUIRE(t == targets({a, b, c}));
+        }
+    });
+}
+
+SEASTAR_TEST_CASE(test_speculation_delay) {
+    locator::dynamic_snitch ds(make_config());
+    auto a = inet_address("127.0.0.1");
+    auto b = inet_address("127.0.0.2");
+    auto c = inet_address("127.0.0.3");
+    std::vector<inet_address> targets{a, b, c};
+    auto contacted_end = targets.end() - 1;
+
+    // No estimates, the table's delay is used.
+    BOOST_REQUIRE(!ds.speculation_delay(targets.begin(), contacted_end, 100ms));
+
+    // A single sample gives a high estimate of three times the latency.
+    record(ds, a, 10ms);
+    BOOST_REQUIRE(!ds.speculation_delay(targets.begin(), contacted_end, 100ms));
+    record(ds, b, 20ms);
+    auto d = ds.speculation_delay(targets.begin(), contacted_end, 100ms);
+    BOOST_REQUIRE(d);
+    BOOST_REQUIRE(*d == 60ms);
+
+    // The delay is only ever shortened.
+    BOOST_REQUIRE(!ds.speculation_delay(targets.begin(), contacted_end, 50ms));
+
+    // The extra replica doesn't count.
+    record(ds, c, 1s);
+    BOOST_REQUIRE(*ds.speculation_delay(targets.begin(), contacted_end, 100ms) == 60ms);
+
+    // And it is never shortened below a millisecond.
+    locator::dynamic_snitch fast(make_config());
+    record(fast, a, 10us);
+    BOOST_REQUIRE(*fast.speculation_delay(targets.begin(), targets.begin() + 1, 100ms) == 1ms);
+
+    BOOST_REQUIRE(!ds.speculation_delay(targets.begin(), targets.begin(), 100ms));
+    return make_ready_future<>();
+}
+
+SEASTAR_TEST_CASE(test_disabled_dynamic_snitch) {
+    return seastar::async([] {
+        locator::i_endpoint_snitch::create_snitch("SimpleSnitch").get();
+        auto stop_snitch = defer([] { locator::i_endpoint_snitch::stop_snitch().get(); });
+
+        auto cfg = make_config();
+        cfg.enabled = false;
+        locator::dynamic_snitch ds(cfg);
+        auto a = inet_address("127.0.0.1");
+        auto b = inet_address("127.0.0.2");
+        auto c = inet_address("127.0.0.3");
+
+        record(ds, a, 50ms);
+        record(ds, b, 1ms);
+        record(ds, c, 1ms);
+        ds.record_cache_hit_rate(b, 1);
+        ds.update_scores();
+
+        BOOST_REQUIRE(!ds.latency_mean(a));
+        BOOST_REQUIRE(!ds.latency_high_estimate(a));
+        BOOST_REQUIRE(ds.scores().empty());
+
+        std::vector<inet_address> targets{a, b, c};
+        ds.order_by_latency(targets, true);
+        BOOST_REQUIRE(targets == std::vector<inet_address>({a, b, c}));
+        ds.sort_by_score(targets);
+        BOOST_REQUIRE(targets == std::vector<inet_address>({a, b, c}));
+        BOOST_REQUIRE(!ds.speculation_delay(targets.begin(), targets.end() - 1, 100ms));
+    });
+}
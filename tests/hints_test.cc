@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2018 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+#include <seastar/core/thread.hh>
+
+#include "tests/test-utils.hh"
+#include "db/hints/hints_batch.hh"
+#include "schema_builder.hh"
+
+using namespace db::hints;
+
+static schema_ptr make_schema() {
+    return schema_builder("ks", "cf")
+            .with_column("p", int32_type, column_kind::partition_key)
+            .with_column("v1", int32_type)
+            .with_column("v2", int32_type)
+            .build();
+}
+
+static mutation make_mutation(schema_ptr s, int32_t key, const char* column, int32_t value) {
+    mutation m(s, partition_key::from_single_value(*s, int32_type->decompose(key)));
+    m.set_clustered_cell(clustering_key::make_empty(), column, data_value(value), 1);
+    return m;
+}
+
+SEASTAR_TEST_CASE(test_hints_batch_coalesces_by_partition) {
+    return seastar::async([] {
+        auto s = make_schema();
+        resource_manager rm(1024 * 1024);
+
+        auto a1 = make_mutation(s, 1, "v1", 1);
+        auto b = make_mutation(s, 2, "v1", 2);
+        auto a2 = make_mutation(s, 1, "v2", 3);
+
+        hints_batch batch;
+        BOOST_REQUIRE(!batch.add({freeze(a1), s}, db::replay_position(1, 10), 100, rm.get_send_units_for(100).get0()));
+        BOOST_REQUIRE(!batch.add({freeze(b), s}, db::replay_position(1, 20), 200, rm.get_send_units_for(200).get0()));
+        BOOST_REQUIRE(batch.add({freeze(a2), s}, db::replay_position(1, 30), 300, rm.get_send_units_for(300).get0()));
+
+        BOOST_REQUIRE_EQUAL(batch.partitions(), 2);
+        BOOST_REQUIRE_EQUAL(batch.size(), 600);
+
+        auto expected_a = a1;
+        expected_a.apply(a2);
+        std::vector<mutation> sent;
+        std::vector<std::vector<db::replay_position>> rps;
+        for (auto&& e : batch.hints()) {
+            auto m = e.second.release();
+            sent.push_back(m.fm.unfreeze(m.s));
+            rps.push_back(e.second.rps);
+        }
+        // Ordered by token.
+        BOOST_REQUIRE(sent[0].token() < sent[1].token());
+        auto& sent_a = sent[0].decorated_key().equal(*s, a1.decorated_key()) ? sent[0] : sent[1];
+        auto& sent_b = &sent_a == &sent[0] ? sent[1] : sent[0];
+        auto& rps_a = &sent_a == &sent[0] ? rps[0] : rps[1];
+        BOOST_REQUIRE_EQUAL(sent_a, expected_a);
+        BOOST_REQUIRE_EQUAL(sent_b, b);
+        BOOST_REQUIRE(rps_a == std::vector<db::replay_position>({db::replay_position(1, 10), db::replay_position(1, 30)}));
+    });
+}
+
+SEASTAR_TEST_CASE(test_hints_batch_holds_send_units) {
+    return seastar::async([] {
+        auto s = make_schema();
+        const size_t hint_size = 32 * 1024;
+        // Room for four hints of hint_size.
+        resource_manager rm(4 * hint_size);
+
+        hints_batch batch;
+        BOOST_REQUIRE(!batch.must_send_before(rm, hint_size));
+        for (int i = 0; i < 4; ++i) {
+            BOOST_REQUIRE(!batch.must_send_before(rm, hint_size));
+            auto m = make_mutation(s, i, "v1", i);
+            batch.add({freeze(m), s}, db::replay_position(1, i), hint_size, rm.get_send_units_for(hint_size).get0());
+        }
+
+        // The next hint would wait for units held by the batch itself.
+        BOOST_REQUIRE(!rm.can_get_send_units_for(hint_size));
+        BOOST_REQUIRE(batch.must_send_before(rm, hint_size));
+
+        // Sending the batch releases them.
+        {
+            auto sent = std::exchange(batch, hints_batch());
+            BOOST_REQUIRE(batch.empty());
+            BOOST_REQUIRE(!batch.must_send_before(rm, hint_size));
+            BOOST_REQUIRE(!rm.can_get_send_units_for(hint_size));
+        }
+        BOOST_REQUIRE(rm.can_get_send_units_for(hint_size));
+        BOOST_REQUIRE(!batch.must_send_before(rm, hint_size));
+    });
+}
@@ -1316,4 +1316,40 @@ SEASTAR_THREAD_TEST_CASE(test_can_reclaim_contiguous_memory_with_mixed_allocatio
         large_allocs.push_back(std::move(up));
     }
 }
+
+SEASTAR_THREAD_TEST_CASE(test_background_reclaim_compacts_fragmented_regions) {
+    prime_segment_pool(memory::stats().total_memory(), memory::min_free_memory()).get();  // if previous test cases muddied the pool
+
+    region r;
+    std::deque<managed_bytes> allocs;
+
+    auto clean_up = defer([&] {
+        with_allocator(r.allocator(), [&] {
+            allocs.clear();
+        });
+    });
+
+    // Use up all memory, then free half of it randomly so that segments are sparse,
+    // but none of them is free.
+    with_allocator(r.allocator(), [&] {
+        try {
+            while (true) {
+                allocs.push_back(managed_bytes(managed_bytes::initialized_later(), 1024));
+            }
+        } catch (std::bad_alloc&) {
+        }
+        std::random_device rnd_dev;
+        std::shuffle(allocs.begin(), allocs.end(), std::default_random_engine(rnd_dev()));
+        allocs.erase(allocs.begin() + allocs.size() / 2, allocs.end());
+    });
+
+    auto reclaim_counter = r.reclaim_counter();
+    shard_tracker().start_background_reclaim(default_scheduling_group(), 16);
+    auto deadline = lowres_clock::now() + std::chrono::seconds(10);
+    while (r.reclaim_counter() == reclaim_counter && lowres_clock::now() < deadline) {
+        seastar::sleep(std::chrono::milliseconds(10)).get();
+    }
+    shard_tracker().stop_background_reclaim().get();
+    BOOST_REQUIRE(r.reclaim_counter() != reclaim_counter);
+}
 #endif
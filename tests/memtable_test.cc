@@ -29,6 +29,7 @@
 
 #include <seastar/core/thread.hh>
 #include "memtable.hh"
+#include "frozen_mutation.hh"
 #include "mutation_source_test.hh"
 #include "mutation_assertions.hh"
 #include "flat_mutation_reader_assertions.hh"
@@ -164,6 +165,67 @@ SEASTAR_TEST_CASE(test_memtable_flush_reader) {
     });
 }
 
+SEASTAR_TEST_CASE(test_memtable_split_for_flush) {
+    return seastar::async([] {
+        random_mutation_generator gen(random_mutation_generator::generate_counters::no);
+        auto s = gen.schema();
+        dirty_memory_manager mgr;
+        auto muts = gen(64);
+        std::sort(muts.begin(), muts.end(), mutation_decorated_key_less_comparator());
+
+        auto mt = make_lw_shared<memtable>(s, mgr);
+        for (auto& m : muts) {
+            mt->apply(m);
+        }
+
+        BOOST_REQUIRE_EQUAL(mt->split_for_flush(1).size(), 1);
+
+        // The ranges are disjoint, in ring order, and together cover all partitions.
+        auto ranges = mt->split_for_flush(4);
+        BOOST_REQUIRE_GT(ranges.size(), 1);
+        BOOST_REQUIRE_LE(ranges.size(), 4);
+        auto next = muts.begin();
+        for (auto&& range : ranges) {
+            auto rd = assert_that(mt->make_flush_reader(s, default_priority_class(), range));
+            while (next != muts.end() && range.contains(next->decorated_key(), dht::ring_position_comparator(*s))) {
+                rd.produces_partition(*next++);
+            }
+            rd.produces_end_of_stream();
+        }
+        BOOST_REQUIRE(next == muts.end());
+    });
+}
+
+SEASTAR_TEST_CASE(test_memtable_apply_frozen_with_and_without_snapshots) {
+    return seastar::async([] {
+        random_mutation_generator gen(random_mutation_generator::generate_counters::no);
+        auto s = gen.schema();
+
+        for (auto i = 0; i < 16; i++) {
+            auto m1 = gen();
+            auto m2 = mutation(s, m1.decorated_key(), gen().partition());
+            auto m3 = mutation(s, m1.decorated_key(), gen().partition());
+
+            auto mt = make_lw_shared<memtable>(s);
+            mt->apply(freeze(m1), s);
+
+            // While the reader holds a snapshot, the write goes to a new version.
+            {
+                auto rd = mt->make_flat_reader(s);
+                rd(db::no_timeout).get();
+                mt->apply(freeze(m2), s);
+            }
+
+            // Without snapshots, the write is applied to the latest version in place.
+            mt->apply(freeze(m3), s);
+
+            assert_that(mt->make_flat_reader(s))
+                .produces(m1 + m2 + m3)
+                .produces_end_of_stream();
+        }
+    });
+}
+
 SEASTAR_TEST_CASE(test_adding_a_column_during_reading_doesnt_affect_read_result) {
     return seastar::async([] {
         auto common_builder = schema_builder("ks", "cf")
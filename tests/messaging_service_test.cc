@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2018 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+#include <seastar/core/gate.hh>
+#include <seastar/util/defer.hh>
+
+#include "tests/test-utils.hh"
+#include "tests/eventually.hh"
+#include "message/messaging_service.hh"
+#include "message/mutation_batch.hh"
+#include "schema_builder.hh"
+#include "locator/snitch_base.hh"
+#include "utils/fb_utilities.hh"
+
+SEASTAR_TEST_CASE(test_shard_aware_clients) {
+    return seastar::async([] {
+        utils::fb_utilities::set_broadcast_address(gms::inet_address("127.0.0.1"));
+
+        locator::i_endpoint_snitch::create_snitch("SimpleSnitch").get();
+        auto stop_snitch = defer([] { locator::i_endpoint_snitch::stop_snitch().get(); });
+
+        netw::get_messaging_service().start(gms::inet_address("127.0.0.1"), 7000, false /* don't bind */).get();
+        auto stop_messaging_service = defer([] { netw::get_messaging_service().stop().get(); });
+
+        auto& ms = netw::get_local_messaging_service();
+        auto count_clients = [&ms] {
+            size_t n = 0;
+            ms.foreach_client([&n] (const netw::msg_addr&, const netw::messaging_service::shard_info&) { ++n; });
+            return n;
+        };
+        // Nothing listens there, the connections are never established.
+        auto peer = gms::inet_address("127.0.0.2");
+        auto verb = netw::messaging_verb::MUTATION;
+
+        // All shards of a peer share a connection by default.
+        auto c0 = ms.get_rpc_client(verb, netw::msg_addr{peer, 0});
+        auto c1 = ms.get_rpc_client(verb, netw::msg_addr{peer, 1});
+        BOOST_REQUIRE(c0 == c1);
+        BOOST_REQUIRE_EQUAL(count_clients(), 1);
+        ms.remove_rpc_client(netw::msg_addr{peer, 0});
+        BOOST_REQUIRE_EQUAL(count_clients(), 0);
+
+        ms.set_shard_aware_connections(true);
+        c0 = ms.get_rpc_client(verb, netw::msg_addr{peer, 0});
+        c1 = ms.get_rpc_client(verb, netw::msg_addr{peer, 1});
+        BOOST_REQUIRE(c0 != c1);
+        BOOST_REQUIRE(ms.get_rpc_client(verb, netw::msg_addr{peer, 1}) == c1);
+        BOOST_REQUIRE_EQUAL(count_clients(), 2);
+
+        // Dropping a peer drops the connections to all of its shards.
+        ms.remove_rpc_client(netw::msg_addr{peer, 0});
+        BOOST_REQUIRE_EQUAL(count_clients(), 0);
+    });
+}
+
+SEASTAR_TEST_CASE(test_pick_shard_aware_port) {
+    using ms = netw::messaging_service;
+    unsigned low = ms::shard_aware_port_low;
+    unsigned high = ms::shard_aware_port_high;
+    for (unsigned shard_count : {1u, 2u, 3u, 7u, 16u, 64u, 255u}) {
+        for (unsigned shard = 0; shard < shard_count; ++shard) {
+            for (int i = 0; i < 100; ++i) {
+                unsigned port = ms::pick_shard_aware_port(shard, shard_count);
+                BOOST_REQUIRE_EQUAL(port % shard_count, shard);
+                BOOST_REQUIRE_GE(port, low);
+                BOOST_REQUIRE_LE(port, high);
+            }
+        }
+    }
+    return make_ready_future<>();
+}
+
+namespace {
+
+struct sent_batch {
+    netw::msg_addr ep;
+    std::vector<netw::mutation_batch_entry> entries;
+    promise<> done;
+};
+
+// Records the batches a mutation_batcher sends; the test decides when and how sending them completes.
+struct batch_recorder {
+    std::vector<std::unique_ptr<sent_batch>> batches;
+
+    netw::mutation_batcher::send_func send_func() {
+        return [this] (netw::msg_addr ep, netw::mutation_batcher::clock_type::time_point, std::vector<netw::mutation_batch_entry> entries) {
+            batches.push_back(std::make_unique<sent_batch>(sent_batch{ep, std::move(entries), promise<>()}));
+            return batches.back()->done.get_future();
+        };
+    }
+};
+
+}
+
+static netw::mutation_batch_entry make_entry(uint64_t response_id, size_t value_size = 16) {
+    static thread_local auto s = schema_builder("ks", "cf")
+            .with_column("p", int32_type, column_kind::partition_key)
+            .with_column("v", bytes_type)
+            .build();
+    mutation m(s, partition_key::from_single_value(*s, int32_type->decompose(int32_t(response_id))));
+    m.set_clustered_cell(clustering_key::make_empty(), "v", data_value(bytes(value_size, int8_t(1))), 1);
+    return netw::mutation_batch_entry{freeze(m), {}, 0, response_id, stdx::nullopt};
+}
+
+SEASTAR_TEST_CASE(test_mutation_batcher_batches_per_replica_shard) {
+    return seastar::async([] {
+        batch_recorder rec;
+        netw::mutation_batcher batcher(std::chrono::hours(1), 1024 * 1024, rec.send_func());
+        BOOST_REQUIRE(batcher.enabled());
+        auto timeout = netw::mutation_batcher::clock_type::now() + std::chrono::seconds(10);
+        auto peer = gms::inet_address("127.0.0.2");
+
+        std::vector<future<>> shard0;
+        for (uint64_t id = 1; id <= 3; ++id) {
+            shard0.push_back(batcher.add(netw::msg_addr{peer, 0}, timeout, make_entry(id)));
+        }
+        auto shard1 = batcher.add(netw::msg_addr{peer, 1}, timeout, make_entry(4));
+        BOOST_REQUIRE(rec.batches.empty());
+
+        batcher.flush_all();
+        BOOST_REQUIRE_EQUAL(rec.batches.size(), 2);
+        BOOST_REQUIRE_EQUAL(batcher.get_stats().batches_sent, 2);
+        BOOST_REQUIRE_EQUAL(batcher.get_stats().batched_mutations, 4);
+
+        auto& b0 = rec.batches[0]->ep.cpu_id == 0 ? *rec.batches[0] : *rec.batches[1];
+        auto& b1 = rec.batches[0]->ep.cpu_id == 0 ? *rec.batches[1] : *rec.batches[0];
+        // Each entry keeps its own response id, which the replica answers separately.
+        BOOST_REQUIRE_EQUAL(b0.entries.size(), 3);
+        for (uint64_t i = 0; i < 3; ++i) {
+            BOOST_REQUIRE_EQUAL(b0.entries[i].response_id, i + 1);
+        }
+        BOOST_REQUIRE_EQUAL(b1.entries.size(), 1);
+        BOOST_REQUIRE_EQUAL(b1.entries[0].response_id, 4);
+
+        // Entries complete when the message carrying them was sent.
+        for (auto& f : shard0) {
+            BOOST_REQUIRE(!f.available());
+        }
+        b0.done.set_value();
+        for (auto& f : shard0) {
+            f.get();
+        }
+        BOOST_REQUIRE(!shard1.available());
+
+        // A failed send fails every entry of the batch.
+        b1.done.set_exception(std::runtime_error("send failed"));
+        BOOST_REQUIRE_THROW(shard1.get(), std::runtime_error);
+
+        std::vector<future<>> failed;
+        for (uint64_t id = 5; id <= 7; ++id) {
+            failed.push_back(batcher.add(netw::msg_addr{peer, 0}, timeout, make_entry(id)));
+        }
+        batcher.flush_all();
+        rec.batches.back()->done.set_exception(std::runtime_error("send failed"));
+        for (auto& f : failed) {
+            BOOST_REQUIRE_THROW(f.get(), std::runtime_error);
+        }
+    });
+}
+
+SEASTAR_TEST_CASE(test_mutation_batcher_flushes) {
+    return seastar::async([] {
+        batch_recorder rec;
+        netw::mutation_batcher batcher(std::chrono::milliseconds(1), 4096, rec.send_func());
+        auto timeout = netw::mutation_batcher::clock_type::now() + std::chrono::seconds(10);
+        auto ep = netw::msg_addr{gms::inet_address("127.0.0.2"), 0};
+
+        // Once the window expires.
+        auto f = batcher.add(ep, timeout, make_entry(1));
+        eventually([&] {
+            BOOST_REQUIRE_EQUAL(rec.batches.size(), 1);
+        });
+        rec.batches.back()->done.set_value();
+        f.get();
+
+        // Right away once the batch is large enough.
+        auto f1 = batcher.add(ep, timeout, make_entry(2, 2048));
+        BOOST_REQUIRE_EQUAL(rec.batches.size(), 1);
+        auto f2 = batcher.add(ep, timeout, make_entry(3, 2048));
+        BOOST_REQUIRE_EQUAL(rec.batches.size(), 2);
+        BOOST_REQUIRE_EQUAL(rec.batches.back()->entries.size(), 2);
+        rec.batches.back()->done.set_value();
+        f1.get();
+        f2.get();
+    });
+}
+
+SEASTAR_TEST_CASE(test_mutation_batcher_stop) {
+    return seastar::async([] {
+        batch_recorder rec;
+        netw::mutation_batcher batcher(std::chrono::hours(1), 1024 * 1024, rec.send_func());
+        auto timeout = netw::mutation_batcher::clock_type::now() + std::chrono::seconds(10);
+        auto ep = netw::msg_addr{gms::inet_address("127.0.0.2"), 0};
+
+        auto f1 = batcher.add(ep, timeout, make_entry(1));
+        auto f2 = batcher.add(netw::msg_addr{ep.addr, 1}, timeout, make_entry(2));
+        batcher.stop(std::make_exception_ptr(seastar::gate_closed_exception()));
+
+        // Pending entries fail without being sent, and batching is off.
+        BOOST_REQUIRE_THROW(f1.get(), seastar::gate_closed_exception);
+        BOOST_REQUIRE_THROW(f2.get(), seastar::gate_closed_exception);
+        BOOST_REQUIRE(rec.batches.empty());
+        BOOST_REQUIRE(!batcher.enabled());
+        batcher.flush_all();
+        BOOST_REQUIRE(rec.batches.empty());
+    });
+}
@@ -20,6 +20,7 @@
  */
 
 #include "utils/murmur_hash.hh"
+#include "digester.hh"
 #include "tests/perf/perf.hh"
 
 volatile uint64_t black_hole;
@@ -48,5 +49,23 @@ int main(int argc, char* argv[]) {
         sink += dst[1];
     });
 
+    // Digest reads hash every cell of the result, so time the digest
+    // algorithms over a few typical cell sizes.
+    for (size_t size : {16, 128, 1024}) {
+        auto cell = bytes(bytes::initialized_later(), size);
+        std::fill(cell.begin(), cell.end(), int8_t(size));
+
+        for (auto algo : {query::digest_algorithm::MD5, query::digest_algorithm::xxHash}) {
+            std::cout << "Timing " << (algo == query::digest_algorithm::MD5 ? "MD5" : "xxHash")
+                      << " digest of a " << size << " byte cell...\n";
+
+            time_it([&] {
+                query::digester d(algo);
+                d.feed_hash(bytes_view(cell));
+                sink += d.finalize_array()[0];
+            });
+        }
+    }
+
     black_hole = sink;
 }
@@ -21,6 +21,7 @@
  */
 
 #include "database.hh"
+#include "frozen_mutation.hh"
 #include "perf.hh"
 #include <seastar/core/app-template.hh>
 
@@ -40,13 +41,38 @@ int main(int argc, char* argv[]) {
         auto key = partition_key::from_exploded(*s, {to_bytes("key1")});
         auto c_key = clustering_key::from_exploded(*s, {int32_type->decompose(2)});
         bytes value = int32_type->decompose(3);
+        const column_definition& col = *s->get_column_definition("r1");
 
         time_it([&] {
             mutation m(s, key);
-            const column_definition& col = *s->get_column_definition("r1");
             m.set_clustered_cell(c_key, col, make_atomic_cell(col.type, value));
             mt.apply(std::move(m));
         });
+
+        std::cout << "Timing frozen mutation of single column within one row...\n";
+
+        mutation m(s, key);
+        m.set_clustered_cell(c_key, col, make_atomic_cell(col.type, value));
+        auto fm = freeze(m);
+
+        time_it([&] {
+            mt.apply(fm, s);
+        });
+
+        std::cout << "Timing frozen mutations spread over many partitions...\n";
+
+        memtable mt2(s);
+        std::vector<frozen_mutation> fms;
+        for (auto i : boost::irange(0, 100000)) {
+            mutation m(s, partition_key::from_exploded(*s, {to_bytes(sprint("key%d", i))}));
+            m.set_clustered_cell(c_key, col, make_atomic_cell(col.type, value));
+            fms.push_back(freeze(m));
+        }
+        size_t next = 0;
+
+        time_it([&] {
+            mt2.apply(fms[next++ % fms.size()], s);
+        });
         engine().exit(0);
     });
 }
@@ -24,6 +24,8 @@
 #include "tests/perf/perf.hh"
 #include <seastar/core/app-template.hh>
 #include "schema_builder.hh"
+#include "utils/logalloc.hh"
+#include "transport/messages/result_message.hh"
 
 static const sstring table_name = "cf";
 
@@ -44,6 +46,16 @@ static auto execute_update_for_key(cql_test_env& env, const bytes& key) {
         "WHERE \"KEY\"= 0x%s;", to_hex(key))).discard_result();
 };
 
+static auto execute_update_for_row(cql_test_env& env, const bytes& key, int32_t ck) {
+    return env.execute_cql(sprint("UPDATE cf SET "
+        "\"C0\" = 0x8f75da6b3dcec90c8a404fb9a5f6b0621e62d39c69ba5758e5f41b78311fbb26cc7a,"
+        "\"C1\" = 0xa8761a2127160003033a8f4f3d1069b7833ebe24ef56b3beee728c2b686ca516fa51,"
+        "\"C2\" = 0x583449ce81bfebc2e1a695eb59aad5fcc74d6d7311fc6197b10693e1a161ca2e1c64,"
+        "\"C3\" = 0x62bcb1dbc0ff953abc703bcb63ea954f437064c0c45366799658bd6b91d0f92908d7,"
+        "\"C4\" = 0x222fcbe31ffa1e689540e1499b87fa3f9c781065fccd10e4772b4c7039c2efd0fb27 "
+        "WHERE \"KEY\"= 0x%s AND \"CK\" = %d;", to_hex(key), ck)).discard_result();
+};
+
 static auto execute_counter_update_for_key(cql_test_env& env, const bytes& key) {
     return env.execute_cql(sprint("UPDATE cf SET "
         "\"C0\" = \"C0\" + 1,"
@@ -63,6 +75,10 @@ struct test_config {
     bool query_single_key;
     unsigned duration_in_seconds;
     bool counters;
+    bool with_view = false;
+    // Non-zero means every partition has that many rows, and reads return
+    // the whole partition.
+    unsigned rows_per_partition = 0;
     unsigned operations_per_shard = 0;
 };
 
@@ -81,6 +97,8 @@ std::ostream& operator<<(std::ostream& os, const test_config& cfg) {
            << ", mode=" << cfg.mode
            << ", query_single_key=" << (cfg.query_single_key ? "yes" : "no")
            << ", counters=" << (cfg.counters ? "yes" : "no")
+           << ", with_view=" << (cfg.with_view ? "yes" : "no")
+           << ", rows_per_partition=" << cfg.rows_per_partition
            << "}";
 }
 
@@ -91,17 +109,51 @@ future<> create_partitions(cql_test_env& env, test_config& cfg) {
         if (cfg.counters) {
             return execute_counter_update_for_key(env, make_key(sequence));
         }
+        if (cfg.rows_per_partition) {
+            auto rows = boost::irange(0, (int)cfg.rows_per_partition);
+            return do_for_each(rows.begin(), rows.end(), [&env, key = make_key(sequence)] (int ck) {
+                return execute_update_for_row(env, key, ck);
+            });
+        }
         return execute_update_for_key(env, make_key(sequence));
     });
 }
 
+// Goes over all the cells of a result, like the CQL server does when it
+// serializes the result into a response. Results may be generated lazily,
+// so without this reads of wide partitions would skip most of the work.
+class result_consumer {
+    size_t _size = 0;
+public:
+    void start_row() { }
+    void accept_value(std::optional<query::result_bytes_view> cell) {
+        _size += cell ? cell->size_bytes() : 0;
+    }
+    void end_row() { }
+    size_t size() const { return _size; }
+};
+
+static void consume_result(shared_ptr<cql_transport::messages::result_message> msg) {
+    auto rows = dynamic_pointer_cast<cql_transport::messages::result_message::rows>(msg);
+    if (rows) {
+        result_consumer consumer;
+        rows->rs().visit(consumer);
+    }
+}
+
 future<> test_read(cql_test_env& env, test_config& cfg) {
     return create_partitions(env, cfg).then([&env] {
         return env.prepare("select \"C0\", \"C1\", \"C2\", \"C3\", \"C4\" from cf where \"KEY\" = ?");
     }).then([&env, &cfg](auto id) {
         return time_parallel([&env, &cfg, id] {
             bytes key = make_key(cfg.query_single_key ? 0 : std::rand() % cfg.partitions);
-            return env.execute_prepared(id, {{cql3::raw_value::make_value(std::move(key))}}).discard_result();
+            auto f = env.execute_prepared(id, {{cql3::raw_value::make_value(std::move(key))}});
+            if (!cfg.rows_per_partition) {
+                return f.discard_result();
+            }
+            return f.then([] (shared_ptr<cql_transport::messages::result_message> msg) {
+                consume_result(std::move(msg));
+            });
         }, cfg.concurrency, cfg.duration_in_seconds, cfg.operations_per_shard);
     });
 }
@@ -166,12 +218,24 @@ future<> do_test(cql_test_env& env, test_config& cfg) {
         if (cfg.counters) {
             return *make_counter_schema(ks_name);
         }
+        std::vector<schema::column> clustering_columns;
+        if (cfg.rows_per_partition) {
+            clustering_columns.push_back({"CK", int32_type});
+        }
         return schema({}, ks_name, "cf",
                 {{"KEY", bytes_type}},
-                {},
+                clustering_columns,
                 {{"C0", bytes_type}, {"C1", bytes_type}, {"C2", bytes_type}, {"C3", bytes_type}, {"C4", bytes_type}},
                 {},
                 utf8_type);
+    }).then([&env, &cfg] {
+        if (!cfg.with_view) {
+            return make_ready_future<>();
+        }
+        // Every write to cf also generates an update of cf_view, so write
+        // throughput measures the cost of the view update path.
+        return env.execute_cql("CREATE MATERIALIZED VIEW ks.cf_view AS SELECT * FROM cf "
+                "WHERE \"C0\" IS NOT NULL AND \"KEY\" IS NOT NULL PRIMARY KEY (\"C0\", \"KEY\")").discard_result();
     }).then([&env, &cfg] {
         switch (cfg.mode) {
             case test_config::run_mode::read:
@@ -200,7 +264,10 @@ int main(int argc, char** argv) {
         ("query-single-key", "test reading with a single key instead of random keys")
         ("concurrency", bpo::value<unsigned>()->default_value(100), "workers per core")
         ("operations-per-shard", bpo::value<unsigned>(), "run this many operations per shard (overrides duration)")
-        ("counters", "test counters");
+        ("counters", "test counters")
+        ("with-view", "create a materialized view on the table, to test the view update path")
+        ("rows-per-partition", bpo::value<unsigned>()->default_value(0), "make partitions this wide and read them whole, to test serialization of large pages (read path only)")
+        ("lsa-huge-pages", "back cache and memtable memory with transparent huge pages; compare read throughput with and without");
 
     return app.run(argc, argv, [&app] {
         return do_with_cql_env([&app] (auto&& env) {
@@ -210,6 +277,11 @@ int main(int argc, char** argv) {
             cfg->concurrency = app.configuration()["concurrency"].as<unsigned>();
             cfg->query_single_key = app.configuration().count("query-single-key");
             cfg->counters = app.configuration().count("counters");
+            cfg->with_view = app.configuration().count("with-view");
+            cfg->rows_per_partition = app.configuration()["rows-per-partition"].as<unsigned>();
+            if (cfg->with_view && cfg->counters) {
+                throw std::invalid_argument("--with-view can't be used with --counters");
+            }
             if (app.configuration().count("write")) {
                 cfg->mode = test_config::run_mode::write;
             } else if (app.configuration().count("delete")) {
@@ -217,10 +289,16 @@ int main(int argc, char** argv) {
             } else {
                 cfg->mode = test_config::run_mode::read;
             };
+            if (cfg->rows_per_partition && (cfg->mode != test_config::run_mode::read || cfg->counters || cfg->with_view)) {
+                throw std::invalid_argument("--rows-per-partition can only be used for reads, without --counters or --with-view");
+            }
             if (app.configuration().count("operations-per-shard")) {
                 cfg->operations_per_shard = app.configuration()["operations-per-shard"].as<unsigned>();
             }
-            return do_test(env, *cfg).finally([cfg] {});
+            auto f = app.configuration().count("lsa-huge-pages") ? logalloc::advise_huge_pages() : make_ready_future<>();
+            return f.then([&env, cfg] {
+                return do_test(env, *cfg);
+            }).finally([cfg] {});
         });
     });
 }
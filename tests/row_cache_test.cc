@@ -749,6 +749,34 @@ SEASTAR_TEST_CASE(test_eviction) {
     });
 }
 
+SEASTAR_TEST_CASE(test_hot_partitions) {
+    return seastar::async([] {
+        auto s = make_schema();
+        auto mt = make_lw_shared<memtable>(s);
+
+        cache_tracker tracker;
+        row_cache cache(s, snapshot_source_from_snapshot(mt->as_data_source()), tracker);
+
+        std::vector<mutation> muts;
+        for (int i = 0; i < 10; i++) {
+            muts.push_back(make_new_mutation(s));
+            cache.populate(muts.back());
+        }
+
+        verify_has(cache, muts[3]);
+        verify_has(cache, muts[7]);
+
+        auto hot = tracker.hot_partitions(2, 1000);
+        BOOST_REQUIRE_EQUAL(hot.size(), 2);
+        BOOST_REQUIRE(hot[0].table_id == s->id());
+        BOOST_REQUIRE(hot[0].key.equal(*s, muts[7].key()));
+        BOOST_REQUIRE(hot[1].key.equal(*s, muts[3].key()));
+
+        BOOST_REQUIRE_EQUAL(tracker.hot_partitions(100, 1000).size(), muts.size());
+        BOOST_REQUIRE_LE(tracker.hot_partitions(100, 1).size(), 1);
+    });
+}
+
 #ifndef DEFAULT_ALLOCATOR // Depends on eviction, which is absent with the std allocator
 
 SEASTAR_TEST_CASE(test_eviction_from_invalidated) {
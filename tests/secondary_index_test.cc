@@ -571,3 +571,80 @@ SEASTAR_TEST_CASE(test_secondary_index_collections) {
         });
     });
 }
+
+SEASTAR_TEST_CASE(test_local_secondary_index) {
+    return do_with_cql_env_thread([] (cql_test_env& e) {
+        e.execute_cql("create table t (p1 int, p2 int, c int, v int, primary key ((p1, p2), c))").get();
+
+        BOOST_REQUIRE_THROW(e.execute_cql("create index on t((p2, p1), v)").get(), exceptions::invalid_request_exception);
+        BOOST_REQUIRE_THROW(e.execute_cql("create index on t((p1), v)").get(), exceptions::invalid_request_exception);
+        BOOST_REQUIRE_THROW(e.execute_cql("create index on t((p1, p2), p1)").get(), exceptions::invalid_request_exception);
+
+        e.execute_cql("create index local_v on t((p1, p2), v)").get();
+        auto view = e.local_db().find_schema("ks", "local_v_index");
+        BOOST_REQUIRE_EQUAL(view->partition_key_size(), 2);
+        BOOST_REQUIRE(view->clustering_key_columns().begin()->name_as_text() == "v");
+
+        e.execute_cql("insert into t (p1, p2, c, v) values (1, 2, 1, 7)").get();
+        e.execute_cql("insert into t (p1, p2, c, v) values (1, 2, 2, 8)").get();
+        e.execute_cql("insert into t (p1, p2, c, v) values (1, 2, 3, 7)").get();
+        e.execute_cql("insert into t (p1, p2, c, v) values (2, 2, 1, 7)").get();
+
+        eventually([&] {
+            auto res = e.execute_cql("select c from t where p1 = 1 and p2 = 2 and v = 7").get0();
+            assert_that(res).is_rows().with_rows({
+                {{int32_type->decompose(1)}},
+                {{int32_type->decompose(3)}},
+            });
+        });
+        eventually([&] {
+            auto res = e.execute_cql("select p1, c from t where v = 7").get0();
+            assert_that(res).is_rows().with_rows_ignore_order({
+                {{int32_type->decompose(1)}, {int32_type->decompose(1)}},
+                {{int32_type->decompose(1)}, {int32_type->decompose(3)}},
+                {{int32_type->decompose(2)}, {int32_type->decompose(1)}},
+            });
+        });
+    });
+}
+
+SEASTAR_TEST_CASE(test_index_multi_partition_page) {
+    return do_with_cql_env_thread([] (auto& e) {
+        e.execute_cql("CREATE TABLE tab (p int, c int, v int, PRIMARY KEY (p, c))").get();
+        e.execute_cql("CREATE INDEX ON tab (v)").get();
+
+        // More partitions than base table lookups kept in flight, several
+        // matching rows in each, and non-matching rows in between them.
+        std::vector<std::vector<bytes_opt>> expected;
+        for (int p = 0; p < 100; ++p) {
+            for (int c = 0; c < 6; ++c) {
+                int v = c % 2;
+                e.execute_cql(format("INSERT INTO tab (p, c, v) VALUES ({}, {}, {})", p, c, v)).get();
+                if (v == 1) {
+                    expected.push_back({int32_type->decompose(p), int32_type->decompose(c)});
+                }
+            }
+        }
+
+        eventually([&] {
+            auto res = e.execute_cql("SELECT p, c FROM tab WHERE v = 1").get0();
+            assert_that(res).is_rows().with_rows_ignore_order(expected);
+        });
+
+        eventually([&] {
+            auto res = e.execute_cql("SELECT p, c FROM tab WHERE v = 1 AND p = 17").get0();
+            assert_that(res).is_rows().with_rows({
+                {{int32_type->decompose(17)}, {int32_type->decompose(1)}},
+                {{int32_type->decompose(17)}, {int32_type->decompose(3)}},
+                {{int32_type->decompose(17)}, {int32_type->decompose(5)}},
+            });
+        });
+
+        eventually([&] {
+            auto qo = std::make_unique<cql3::query_options>(db::consistency_level::LOCAL_ONE, infinite_timeout_config, std::vector<cql3::raw_value>{},
+                    cql3::query_options::specific_options{100, nullptr, {}, api::new_timestamp()});
+            auto res = e.execute_cql("SELECT p, c FROM tab WHERE v = 1", std::move(qo)).get0();
+            assert_that(res).is_rows().with_size(100);
+        });
+    });
+}
@@ -111,3 +111,54 @@ SEASTAR_TEST_CASE(test_get_restricted_ranges) {
         });
     });
 }
+
+SEASTAR_TEST_CASE(test_range_scan_concurrency) {
+    using sp = service::storage_proxy;
+    using estimate = sp::range_scan_estimate;
+
+    // Without an estimate, the number of ranges doubles each round.
+    BOOST_REQUIRE_EQUAL(sp::range_scan_concurrency(estimate{}, 1000, 1000, 0), 1);
+    BOOST_REQUIRE_EQUAL(sp::range_scan_concurrency(estimate{}, 1000, 1000, 1), 2);
+    BOOST_REQUIRE_EQUAL(sp::range_scan_concurrency(estimate{}, 1000, 1000, 16), 32);
+    BOOST_REQUIRE_EQUAL(sp::range_scan_concurrency(estimate{}, 1000, 1000, 100), 128);
+    BOOST_REQUIRE_EQUAL(sp::range_scan_concurrency(estimate{}, 1000, 5, 16), 5);
+
+    // Enough ranges to return the remaining rows, less the margin.
+    BOOST_REQUIRE_EQUAL(sp::range_scan_concurrency(estimate{10, 0}, 895, 1000, 0), 100);
+    BOOST_REQUIRE_EQUAL(sp::range_scan_concurrency(estimate{10, 0}, 895, 50, 0), 50);
+    BOOST_REQUIRE_EQUAL(sp::range_scan_concurrency(estimate{10000, 0}, 100, 1000, 0), 1);
+
+    // No more than 128 ranges, however few rows they hold.
+    BOOST_REQUIRE_EQUAL(sp::range_scan_concurrency(estimate{1, 0}, 100000, 1000, 0), 128);
+
+    // No more ranges than the bytes target allows, and at least one.
+    BOOST_REQUIRE_EQUAL(sp::range_scan_concurrency(estimate{1, sp::range_scan_bytes_target / 16}, 1000, 1000, 0), 16);
+    BOOST_REQUIRE_EQUAL(sp::range_scan_concurrency(estimate{0, sp::range_scan_bytes_target / 16}, 1000, 1000, 64), 16);
+    BOOST_REQUIRE_EQUAL(sp::range_scan_concurrency(estimate{1, sp::range_scan_bytes_target * 2}, 1000, 1000, 0), 1);
+    return make_ready_future<>();
+}
+
+SEASTAR_TEST_CASE(test_range_scan_estimate_update) {
+    using estimate = service::storage_proxy::range_scan_estimate;
+
+    // A complete round moves the estimate halfway toward what it returned.
+    estimate e{10, 1000};
+    e.update(estimate{20, 3000}, true);
+    BOOST_REQUIRE_EQUAL(e.rows_per_range, 15);
+    BOOST_REQUIRE_EQUAL(e.bytes_per_range, 2000);
+    e.update(estimate{5, 1000}, true);
+    BOOST_REQUIRE_EQUAL(e.rows_per_range, 10);
+    BOOST_REQUIRE_EQUAL(e.bytes_per_range, 1500);
+
+    // A round cut short only tells the ranges hold at least that much.
+    e.update(estimate{4, 500}, false);
+    BOOST_REQUIRE_EQUAL(e.rows_per_range, 10);
+    BOOST_REQUIRE_EQUAL(e.bytes_per_range, 1500);
+    e.update(estimate{30, 1000}, false);
+    BOOST_REQUIRE_EQUAL(e.rows_per_range, 30);
+    BOOST_REQUIRE_EQUAL(e.bytes_per_range, 1500);
+    e.update(estimate{20, 4000}, false);
+    BOOST_REQUIRE_EQUAL(e.rows_per_range, 30);
+    BOOST_REQUIRE_EQUAL(e.bytes_per_range, 4000);
+    return make_ready_future<>();
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2018 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+#include <seastar/core/thread.hh>
+
+#include "tests/test-utils.hh"
+#include "tests/eventually.hh"
+#include "db/view/view.hh"
+#include "db/view/view_update_backlog.hh"
+#include "schema_builder.hh"
+
+using namespace std::chrono_literals;
+
+static schema_ptr make_view_schema() {
+    return schema_builder("ks", "mv")
+            .with_column("p", int32_type, column_kind::partition_key)
+            .with_column("c", int32_type, column_kind::clustering_key)
+            .with_column("v", int32_type)
+            .build();
+}
+
+static mutation make_view_update(schema_ptr s, int32_t key, int32_t ck, int32_t value) {
+    mutation m(s, partition_key::from_single_value(*s, int32_type->decompose(key)));
+    m.set_clustered_cell(clustering_key::from_single_value(*s, int32_type->decompose(ck)), "v", data_value(value), 1);
+    return m;
+}
+
+SEASTAR_TEST_CASE(test_view_update_coalescer_merges_within_window) {
+    return seastar::async([] {
+        auto s = make_view_schema();
+        db::view::stats stats("test");
+        db::timeout_semaphore sem(10);
+        std::vector<std::pair<dht::token, std::vector<mutation>>> sent;
+        db::view::view_update_coalescer coalescer(50ms, stats, [&sent] (dht::token base_token, std::vector<mutation> updates) {
+            sent.emplace_back(base_token, std::move(updates));
+            return make_ready_future<>();
+        });
+
+        auto t1 = dht::global_partitioner().get_token(*s, partition_key::from_single_value(*s, int32_type->decompose(100)));
+        auto t2 = dht::global_partitioner().get_token(*s, partition_key::from_single_value(*s, int32_type->decompose(200)));
+        auto u1 = make_view_update(s, 1, 1, 1);
+        auto u2 = make_view_update(s, 1, 2, 2);
+        auto u3 = make_view_update(s, 2, 1, 3);
+
+        // Two base writes to the same base partition, updating the same view partition.
+        coalescer.add(t1, {u1}, get_units(sem, 1).get0());
+        coalescer.add(t1, {u2}, get_units(sem, 1).get0());
+        // Another base partition.
+        coalescer.add(t2, {u3}, get_units(sem, 1).get0());
+
+        // Nothing is sent before the window expires, and the units are held meanwhile.
+        BOOST_REQUIRE(sent.empty());
+        BOOST_REQUIRE_EQUAL(stats.view_updates_coalesced, 1);
+        BOOST_REQUIRE_EQUAL(sem.available_units(), 7);
+
+        eventually([&] {
+            BOOST_REQUIRE_EQUAL(sent.size(), 2);
+            BOOST_REQUIRE_EQUAL(sem.available_units(), 10);
+        });
+
+        auto expected = u1;
+        expected.apply(u2);
+        for (auto&& b : sent) {
+            BOOST_REQUIRE_EQUAL(b.second.size(), 1);
+            if (b.first == t1) {
+                BOOST_REQUIRE_EQUAL(b.second[0], expected);
+            } else {
+                BOOST_REQUIRE(b.first == t2);
+                BOOST_REQUIRE_EQUAL(b.second[0], u3);
+            }
+        }
+
+        coalescer.stop().get();
+    });
+}
+
+SEASTAR_TEST_CASE(test_view_update_coalescer_flushes_on_stop) {
+    return seastar::async([] {
+        auto s = make_view_schema();
+        db::view::stats stats("test");
+        db::timeout_semaphore sem(10);
+        size_t sent = 0;
+        db::view::view_update_coalescer coalescer(1h, stats, [&sent] (dht::token, std::vector<mutation> updates) {
+            sent += updates.size();
+            return make_ready_future<>();
+        });
+
+        auto t = dht::global_partitioner().get_token(*s, partition_key::from_single_value(*s, int32_type->decompose(100)));
+        coalescer.add(t, {make_view_update(s, 1, 1, 1)}, get_units(sem, 1).get0());
+        BOOST_REQUIRE_EQUAL(sent, 0);
+
+        coalescer.stop().get();
+        BOOST_REQUIRE_EQUAL(sent, 1);
+        BOOST_REQUIRE_EQUAL(sem.available_units(), 10);
+    });
+}
+
+SEASTAR_TEST_CASE(test_view_update_coalescer_disabled) {
+    return seastar::async([] {
+        auto s = make_view_schema();
+        db::view::stats stats("test");
+        db::timeout_semaphore sem(10);
+        size_t sent = 0;
+        db::view::view_update_coalescer coalescer(0us, stats, [&sent] (dht::token, std::vector<mutation> updates) {
+            sent += updates.size();
+            return make_ready_future<>();
+        });
+
+        auto t = dht::global_partitioner().get_token(*s, partition_key::from_single_value(*s, int32_type->decompose(100)));
+        coalescer.add(t, {make_view_update(s, 1, 1, 1)}, get_units(sem, 1).get0());
+        coalescer.add(t, {make_view_update(s, 1, 2, 2)}, get_units(sem, 1).get0());
+        BOOST_REQUIRE_EQUAL(sent, 2);
+        BOOST_REQUIRE_EQUAL(stats.view_updates_coalesced, 0);
+
+        coalescer.stop().get();
+    });
+}
+
+SEASTAR_TEST_CASE(test_view_update_throttling_delay) {
+    using db::view::update_backlog;
+    const auto budget = std::chrono::milliseconds(1000);
+
+    BOOST_REQUIRE(db::view::throttling_delay(update_backlog::no_backlog(), budget) == 0ms);
+    BOOST_REQUIRE(db::view::throttling_delay(update_backlog{0, 100}, budget) == 0ms);
+    BOOST_REQUIRE(db::view::throttling_delay(update_backlog{100, 100}, budget) == budget);
+    // A backlog over the limit doesn't delay writes further.
+    BOOST_REQUIRE(db::view::throttling_delay(update_backlog{200, 100}, budget) == budget);
+    // The cube of the relative backlog.
+    BOOST_REQUIRE(db::view::throttling_delay(update_backlog{50, 100}, budget) == budget / 8);
+
+    auto previous = 0ms;
+    for (uint64_t current = 1; current <= 100; ++current) {
+        auto delay = db::view::throttling_delay(update_backlog{current, 100}, budget);
+        BOOST_REQUIRE(delay >= previous);
+        previous = delay;
+    }
+
+    // No time left until the timeout, or no backlog limit.
+    BOOST_REQUIRE(db::view::throttling_delay(update_backlog{100, 100}, 0ms) == 0ms);
+    BOOST_REQUIRE(db::view::throttling_delay(update_backlog{0, 0}, budget) == 0ms);
+    return make_ready_future<>();
+}
+
+SEASTAR_TEST_CASE(test_response_without_view_update_backlog) {
+    using db::view::update_backlog;
+    auto relative_size = [] (update_backlog b) { return b.relative_size(); };
+
+    // A response from a replica which doesn't report its backlog changes nothing.
+    auto b = db::view::max_backlog(update_backlog::no_backlog(), stdx::nullopt);
+    BOOST_REQUIRE_EQUAL(relative_size(b), 0);
+    BOOST_REQUIRE(db::view::throttling_delay(b, std::chrono::milliseconds(1000)) == 0ms);
+
+    b = db::view::max_backlog(update_backlog{30, 100}, stdx::nullopt);
+    BOOST_REQUIRE_EQUAL(b.current, 30);
+    BOOST_REQUIRE_EQUAL(b.max, 100);
+
+    // Reported backlogs only ever raise it.
+    b = db::view::max_backlog(b, update_backlog{10, 100});
+    BOOST_REQUIRE_EQUAL(b.current, 30);
+    b = db::view::max_backlog(b, update_backlog{60, 100});
+    BOOST_REQUIRE_EQUAL(b.current, 60);
+    return make_ready_future<>();
+}
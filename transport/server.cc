@@ -213,9 +213,14 @@ future<> cql_server::stop() {
 }
 
 future<>
-cql_server::listen(ipv4_addr addr, std::shared_ptr<seastar::tls::credentials_builder> creds, bool keepalive) {
+cql_server::listen(ipv4_addr addr, std::shared_ptr<seastar::tls::credentials_builder> creds, bool is_shard_aware, bool keepalive) {
     listen_options lo;
     lo.reuse_address = true;
+    if (is_shard_aware) {
+        // Accept each connection on shard (client port % smp::count), so a
+        // driver can pick the shard by choosing its source port.
+        lo.lba = server_socket::load_balancing_algorithm::port;
+    }
     server_socket ss;
     try {
         ss = creds
@@ -705,7 +710,9 @@ future<fragmented_temporary_buffer> cql_server::connection::read_and_decompress_
 
 unsigned cql_server::connection::pick_request_cpu()
 {
-    if (_server._lb == cql_load_balance::round_robin) {
+    // Clients connecting to the shard-aware port picked this shard on
+    // purpose, so their requests are never moved to another shard.
+    if (_server._lb == cql_load_balance::round_robin && !is_on_shard_aware_port()) {
         return _request_cpu++ % smp::count;
     }
     return engine().cpu_id();
@@ -1124,6 +1131,9 @@ std::unique_ptr<cql_server::response> cql_server::connection::make_supported(int
     opts.insert({"SCYLLA_SHARDING_ALGORITHM", part.cpu_sharding_algorithm_name()});
     opts.insert({"SCYLLA_SHARDING_IGNORE_MSB", format("{:d}", part.sharding_ignore_msb())});
     opts.insert({"SCYLLA_PARTITIONER", part.name()});
+    if (_server._config.shard_aware_transport_port) {
+        opts.insert({"SCYLLA_SHARD_AWARE_PORT", format("{:d}", *_server._config.shard_aware_transport_port)});
+    }
     auto response = std::make_unique<cql_server::response>(stream, cql_binary_opcode::SUPPORTED, tr_state);
     response->write_string_multimap(opts);
     return response;
@@ -1242,10 +1252,17 @@ cql_server::connection::make_schema_change_event(const event::schema_change& eve
 
 void cql_server::connection::write_response(foreign_ptr<std::unique_ptr<cql_server::response>>&& response, cql_compression compression)
 {
+    ++_pending_responses;
     _ready_to_respond = _ready_to_respond.then([this, compression, response = std::move(response)] () mutable {
         auto message = response->make_message(_version, compression);
         message.on_delete([response = std::move(response)] { });
         return _write_buf.write(std::move(message)).then([this] {
+            // When requests are pipelined, more responses may have been
+            // queued behind this one; let the last of them flush, so that
+            // they all go out in as few syscalls as possible.
+            if (--_pending_responses) {
+                return make_ready_future<>();
+            }
             return _write_buf.flush();
         });
     });
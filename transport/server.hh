@@ -107,6 +107,9 @@ struct cql_query_state {
 struct cql_server_config {
     ::timeout_config timeout_config;
     size_t max_request_size;
+    // Port on which the connection's shard is chosen by the client's source
+    // port, rather than by the kernel. See docs/protocol-extensions.md.
+    std::experimental::optional<uint16_t> shard_aware_transport_port;
 };
 
 class cql_server {
@@ -134,7 +137,7 @@ class cql_server {
 public:
     cql_server(distributed<service::storage_proxy>& proxy, distributed<cql3::query_processor>& qp, cql_load_balance lb, auth::service&,
             cql_server_config config);
-    future<> listen(ipv4_addr addr, std::shared_ptr<seastar::tls::credentials_builder> = {}, bool keepalive = false);
+    future<> listen(ipv4_addr addr, std::shared_ptr<seastar::tls::credentials_builder> = {}, bool is_shard_aware = false, bool keepalive = false);
     future<> do_accepts(int which, bool keepalive, ipv4_addr server_addr);
     future<> stop();
 public:
@@ -161,6 +164,8 @@ class cql_server {
         fragmented_temporary_buffer::reader _buffer_reader;
         seastar::gate _pending_requests_gate;
         future<> _ready_to_respond = make_ready_future<>();
+        // Responses queued on _ready_to_respond but not yet written.
+        unsigned _pending_responses = 0;
         cql_protocol_version_type _version = 0;
         cql_compression _compression = cql_compression::none;
         cql_serialization_format _cql_serialization_format = cql_serialization_format::latest();
@@ -195,6 +200,9 @@ class cql_server {
         future<processing_result> process_request_one(fragmented_temporary_buffer::istream buf, uint8_t op, uint16_t stream, service::client_state client_state, tracing_request_type tracing_request);
         unsigned frame_size() const;
         unsigned pick_request_cpu();
+        bool is_on_shard_aware_port() const {
+            return _server._config.shard_aware_transport_port && *_server._config.shard_aware_transport_port == _server_addr.port;
+        }
         void update_client_state(processing_result& r);
         cql_binary_frame_v3 parse_frame(temporary_buffer<char> buf);
         future<fragmented_temporary_buffer> read_and_decompress_frame(size_t length, uint8_t flags);
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2018 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <seastar/core/lowres_clock.hh>
+
+#include "seastarx.hh"
+#include "utils/latency.hh"
+
+namespace utils {
+
+/**
+ * Estimates the latency of a stream of operations, such as the requests
+ * sent to one replica, giving recent samples exponentially more weight.
+ *
+ * Keeps a smoothed mean and mean deviation, like TCP's round-trip time
+ * estimator (RFC 6298), so that mean() + 4 * deviation() is a cheap
+ * estimate of a high percentile that follows changes within a few dozen
+ * samples. An estimate that hasn't been updated for max_age is considered
+ * stale, since it no longer says anything about the current latency.
+ */
+class latency_estimator {
+public:
+    using duration = latency_counter::duration;
+    using clock = seastar::lowres_clock;
+private:
+    static constexpr double mean_gain = 1.0 / 8;
+    static constexpr double deviation_gain = 1.0 / 4;
+
+    double _mean = 0;
+    double _deviation = 0;
+    clock::time_point _last_update;
+    bool _initialized = false;
+public:
+    void add(duration latency) {
+        double sample = latency.count();
+        if (!_initialized) {
+            _mean = sample;
+            _deviation = sample / 2;
+            _initialized = true;
+        } else {
+            _deviation += deviation_gain * (std::abs(sample - _mean) - _deviation);
+            _mean += mean_gain * (sample - _mean);
+        }
+        _last_update = clock::now();
+    }
+
+    bool has_samples() const {
+        return _initialized;
+    }
+
+    bool is_fresh(clock::duration max_age) const {
+        return _initialized && clock::now() - _last_update <= max_age;
+    }
+
+    duration mean() const {
+        return duration(static_cast<duration::rep>(_mean));
+    }
+
+    duration deviation() const {
+        return duration(static_cast<duration::rep>(_deviation));
+    }
+
+    // An estimate of a high percentile of the latency.
+    duration high_estimate() const {
+        return duration(static_cast<duration::rep>(_mean + 4 * _deviation));
+    }
+};
+
+}
@@ -28,11 +28,16 @@
 #include <boost/intrusive/slist.hpp>
 #include <boost/range/adaptors.hpp>
 #include <stack>
+#include <optional>
+#include <sys/mman.h>
+#include <cstring>
 
 #include <seastar/core/memory.hh>
 #include <seastar/core/align.hh>
 #include <seastar/core/print.hh>
 #include <seastar/core/metrics.hh>
+#include <seastar/core/sleep.hh>
+#include <seastar/core/abort_source.hh>
 #include <seastar/util/alloc_failure_injector.hh>
 #include <seastar/util/backtrace.hh>
 
@@ -319,6 +324,15 @@ class tracker::impl {
     bool _reclaiming_enabled = true;
     size_t _reclamation_step = 1;
     bool _abort_on_bad_alloc = false;
+    size_t _free_segments_goal = 0;
+    // Engaged while the background reclaim fiber runs.
+    std::optional<seastar::abort_source> _background_reclaim_as;
+    future<> _background_reclaim_done = make_ready_future<>();
+    struct stats {
+        uint64_t sync_reclaims = 0;
+        uint64_t sync_reclaim_time_us = 0;
+        uint64_t background_segments_reclaimed = 0;
+    } _stats;
 private:
     // Prevents tracker's reclaimer from running while live. Reclaimer may be
     // invoked synchronously with allocator. This guard ensures that this
@@ -355,6 +369,13 @@ class tracker::impl {
     size_t reclamation_step() const { return _reclamation_step; }
     void enable_abort_on_bad_alloc() { _abort_on_bad_alloc = true; }
     bool should_abort_on_bad_alloc() const { return _abort_on_bad_alloc; }
+    void start_background_reclaim(seastar::scheduling_group sg, size_t free_segments_goal);
+    future<> stop_background_reclaim();
+private:
+    future<> background_reclaim_loop();
+    // Releases about one segment, compacting or evicting like compact_and_evict().
+    // Returns false if nothing could be released.
+    bool reclaim_in_background();
 };
 
 class tracker_reclaimer_lock {
@@ -495,6 +516,8 @@ class segment_pool {
     bool _allocation_failure_flag = false;
     size_t _non_lsa_memory_in_use = 0;
     size_t _non_lsa_reserve = 0;
+    bool _huge_pages = false;
+    uintptr_t _huge_pages_start = 0; // Memory in [_huge_pages_start, _layout.end) was advised to use huge pages
     // Invariants - a segment is in one of the following states:
     //   In use by some region
     //     - set in _lsa_owned_segments_bitmap
@@ -528,9 +551,17 @@ class segment_pool {
     bool can_allocate_more_memory(size_t size) {
         return memory::stats().free_memory() >= _non_lsa_reserve + size;
     }
+    // Extends the range advised to use huge pages down to cover seg.
+    void advise_huge_pages_for(segment* seg);
 public:
     segment_pool();
     void prime(size_t available_memory, size_t min_free_memory);
+    // Asks the kernel to back the memory of all segments, current and future,
+    // with transparent huge pages. Returns false if that's not supported.
+    bool advise_huge_pages();
+    size_t huge_pages_advised_bytes() const {
+        return _huge_pages ? _layout.end - _huge_pages_start : 0;
+    }
     segment* new_segment(region::impl* r);
     segment_descriptor& descriptor(const segment*);
     // Returns segment containing given object or nullptr.
@@ -583,6 +614,12 @@ class segment_pool {
     void on_memory_allocation(size_t size);
     size_t unreserved_free_segments() const { return _free_segments - std::min(_free_segments, _emergency_reserve_max); }
     size_t free_segments() const { return _free_segments; }
+    // Returns true iff allocating goal segments would have to compact or evict
+    // synchronously, because there are not enough free segments and the standard
+    // allocator can't give us more memory.
+    bool below_free_segments_goal(size_t goal) {
+        return _free_segments < _current_emergency_reserve_goal + goal && !can_allocate_more_memory(goal * segment::size);
+    }
 };
 
 size_t segment_pool::reclaim_segments(size_t target) {
@@ -675,6 +712,9 @@ segment* segment_pool::allocate_segment(size_t reserve, size_t reclamation_step)
             auto seg = new (p) segment;
             auto idx = idx_from_segment(seg);
             _lsa_owned_segments_bitmap.set(idx);
+            if (_huge_pages && reinterpret_cast<uintptr_t>(seg) < _huge_pages_start) {
+                advise_huge_pages_for(seg);
+            }
             return seg;
         }
     } while (shard_tracker().get_impl().compact_and_evict(reclamation_step * segment::size));
@@ -790,6 +830,34 @@ void segment_pool::prime(size_t available_memory, size_t min_free_memory) {
     reclaim_segments(_non_lsa_reserve / segment::size);
 }
 
+// Transparent huge pages come in one size on x86_64. Larger pages (1G) are
+// only available through hugetlbfs, see seastar's --hugepages.
+static constexpr size_t huge_page_size = 2 * 1024 * 1024;
+
+bool segment_pool::advise_huge_pages() {
+    auto first = _lsa_owned_segments_bitmap.find_first_set();
+    auto start = first == utils::dynamic_bitset::npos ? _layout.end : reinterpret_cast<uintptr_t>(segment_from_idx(first));
+    start = align_down(start, uintptr_t(huge_page_size));
+    auto end = align_down(uintptr_t(_layout.end), uintptr_t(huge_page_size));
+    if (start < end && ::madvise(reinterpret_cast<void*>(start), end - start, MADV_HUGEPAGE)) {
+        llogger.warn("Transparent huge pages are not available for LSA memory, using regular pages: {}", std::strerror(errno));
+        return false;
+    }
+    _huge_pages = true;
+    _huge_pages_start = start;
+    llogger.debug("Advised {} bytes of LSA memory to use huge pages", huge_pages_advised_bytes());
+    return true;
+}
+
+void segment_pool::advise_huge_pages_for(segment* seg) {
+    auto start = align_down(reinterpret_cast<uintptr_t>(seg), uintptr_t(huge_page_size));
+    // Can only fail if the kernel stopped supporting THP since advise_huge_pages(),
+    // in which case we just keep using regular pages for the new memory.
+    if (!::madvise(reinterpret_cast<void*>(start), _huge_pages_start - start, MADV_HUGEPAGE)) {
+        _huge_pages_start = start;
+    }
+}
+
 #else
 
 // Segment pool version for the standard allocator. Slightly less efficient
@@ -922,6 +990,11 @@ class segment_pool {
     void on_segment_compaction(size_t used_space);
     void on_memory_allocation(size_t size);
     size_t free_segments() const { return 0; }
+    bool advise_huge_pages() { return false; }
+    size_t huge_pages_advised_bytes() const { return 0; }
+    bool below_free_segments_goal(size_t goal) {
+        return _free_segments.size() < goal && _std_memory_available < goal * segment::size;
+    }
 public:
     class reservation_goal;
 };
@@ -1680,6 +1753,14 @@ bool tracker::should_abort_on_bad_alloc() {
     return _impl->should_abort_on_bad_alloc();
 }
 
+void tracker::start_background_reclaim(seastar::scheduling_group sg, size_t free_segments_goal) {
+    _impl->start_background_reclaim(sg, free_segments_goal);
+}
+
+future<> tracker::stop_background_reclaim() {
+    return _impl->stop_background_reclaim();
+}
+
 memory::reclaiming_result tracker::reclaim() {
     return reclaim(_impl->reclamation_step() * segment::size)
            ? memory::reclaiming_result::reclaimed_something
@@ -1943,7 +2024,77 @@ size_t tracker::impl::compact_and_evict(size_t memory_to_release) {
     }
     reclaiming_lock rl(*this);
     reclaim_timer timing_guard;
-    return compact_and_evict_locked(memory_to_release);
+    auto start = clock::now();
+    auto released = compact_and_evict_locked(memory_to_release);
+    ++_stats.sync_reclaims;
+    _stats.sync_reclaim_time_us += std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count();
+    return released;
+}
+
+void tracker::impl::start_background_reclaim(seastar::scheduling_group sg, size_t free_segments_goal) {
+    assert(!_background_reclaim_as);
+    _free_segments_goal = free_segments_goal;
+    _background_reclaim_as.emplace();
+    _background_reclaim_done = with_scheduling_group(sg, [this] {
+        return background_reclaim_loop();
+    });
+}
+
+future<> tracker::impl::stop_background_reclaim() {
+    if (!_background_reclaim_as) {
+        return make_ready_future<>();
+    }
+    _background_reclaim_as->request_abort();
+    return std::exchange(_background_reclaim_done, make_ready_future<>()).finally([this] {
+        _background_reclaim_as = std::nullopt;
+    });
+}
+
+bool tracker::impl::reclaim_in_background() {
+    if (!_reclaiming_enabled) {
+        return false;
+    }
+    reclaiming_lock rl(*this);
+    // Same choice between compaction and eviction as when reclaiming synchronously.
+    auto released = compact_and_evict_locked(segment::size);
+    _stats.background_segments_reclaimed += released / segment::size;
+    return released != 0;
+}
+
+future<> tracker::impl::background_reclaim_loop() {
+    // How long to wait before checking again when there is no pressure or
+    // nothing to reclaim. Doubles while idle, so that an idle shard wakes up
+    // rarely, and drops back to the minimum as soon as there is work.
+    static constexpr auto min_idle_period = std::chrono::milliseconds(1);
+    static constexpr auto max_idle_period = std::chrono::milliseconds(100);
+    return do_with(std::chrono::milliseconds(min_idle_period), [this] (std::chrono::milliseconds& idle_period) {
+        return repeat([this, &idle_period] {
+            if (_background_reclaim_as->abort_requested()) {
+                return make_ready_future<stop_iteration>(stop_iteration::yes);
+            }
+            bool reclaimed = false;
+            while (shard_segment_pool.below_free_segments_goal(_free_segments_goal) && !need_preempt()) {
+                if (!reclaim_in_background()) {
+                    break;
+                }
+                reclaimed = true;
+            }
+            if (reclaimed) {
+                idle_period = min_idle_period;
+                return later().then([] {
+                    return stop_iteration::no;
+                });
+            }
+            auto f = seastar::sleep_abortable(idle_period, *_background_reclaim_as);
+            idle_period = std::min(idle_period * 2, std::chrono::milliseconds(max_idle_period));
+            return f.then([] {
+                return stop_iteration::no;
+            });
+        });
+    }).handle_exception_type([] (const seastar::sleep_aborted&) {
+    }).handle_exception([] (std::exception_ptr ep) {
+        llogger.error("Background reclaim failed: {}", ep);
+    });
 }
 
 size_t tracker::impl::compact_and_evict_locked(size_t memory_to_release) {
@@ -2104,6 +2255,9 @@ tracker::impl::impl() {
         sm::make_gauge("free_space", [this] { return shard_segment_pool.unreserved_free_segments() * segment_size; },
                        sm::description("Holds a current amount of free memory that is under lsa control.")),
 
+        sm::make_gauge("huge_pages_advised_bytes", [this] { return shard_segment_pool.huge_pages_advised_bytes(); },
+                       sm::description("Holds a current amount of memory which the kernel was asked to back with transparent huge pages.")),
+
         sm::make_gauge("occupancy", [this] { return region_occupancy().used_fraction() * 100; },
                        sm::description("Holds a current portion (in percents) of the used memory.")),
 
@@ -2118,6 +2272,15 @@ tracker::impl::impl() {
 
         sm::make_derive("memory_allocated", [this] { return shard_segment_pool.statistics().memory_allocated; },
                         sm::description("Counts number of bytes which were requested from LSA allocator.")),
+
+        sm::make_derive("sync_reclaims", _stats.sync_reclaims,
+                        sm::description("Counts number of times segment allocation had to compact or evict synchronously.")),
+
+        sm::make_derive("sync_reclaim_time_us", _stats.sync_reclaim_time_us,
+                        sm::description("Counts microseconds spent compacting or evicting synchronously with segment allocation.")),
+
+        sm::make_derive("segments_reclaimed_in_background", _stats.background_segments_reclaimed,
+                        sm::description("Counts a number of segments released by compaction or eviction in the background reclaimer.")),
     });
 }
 
@@ -2322,6 +2485,12 @@ future<> prime_segment_pool(size_t available_memory, size_t min_free_memory) {
     });
 }
 
+future<> advise_huge_pages() {
+    return smp::invoke_on_all([] {
+        shard_segment_pool.advise_huge_pages();
+    });
+}
+
 uint64_t memory_allocated() {
     return shard_segment_pool.statistics().memory_allocated;
 }
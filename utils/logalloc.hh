@@ -30,6 +30,7 @@
 #include <seastar/core/future-util.hh>
 #include <seastar/core/circular_buffer.hh>
 #include <seastar/core/expiring_fifo.hh>
+#include <seastar/core/scheduling.hh>
 #include "allocation_strategy.hh"
 #include <boost/heap/binomial_heap.hpp>
 #include "seastarx.hh"
@@ -481,6 +482,16 @@ class tracker {
     void enable_abort_on_bad_alloc();
 
     bool should_abort_on_bad_alloc();
+
+    // Starts a fiber, running in the given scheduling group, which reclaims
+    // segments ahead of time whenever fewer than free_segments_goal free
+    // segments are available and more memory can't be taken from the standard
+    // allocator. It compacts or evicts the way reclaiming in the allocation
+    // path does, which moves that work out of the allocating tasks.
+    void start_background_reclaim(seastar::scheduling_group sg, size_t free_segments_goal);
+
+    // Stops the fiber started by start_background_reclaim(). Resolves when it's done.
+    future<> stop_background_reclaim();
 };
 
 tracker& shard_tracker();
@@ -746,6 +757,12 @@ class allocating_section {
 
 future<> prime_segment_pool(size_t available_memory, size_t min_free_memory);
 
+// Asks the kernel to back memory of LSA segments on all shards with transparent
+// huge pages, reducing TLB misses when traversing large regions. Should be called
+// after prime_segment_pool(). Shards fall back to regular pages if the kernel
+// doesn't support transparent huge pages.
+future<> advise_huge_pages();
+
 uint64_t memory_allocated();
 uint64_t memory_compacted();
 